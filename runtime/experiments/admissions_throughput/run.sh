@@ -0,0 +1,123 @@
+#!/bin/bash
+
+# This experiment measures the completions per second a single module sustains at 32 workers
+# Every completion records an execution sample used to compute the admissions estimate of the module
+
+# Add bash_libraries directory to path
+__run_sh__base_path="$(dirname "$(realpath --logical "${BASH_SOURCE[0]}")")"
+__run_sh__bash_libraries_relative_path="../bash_libraries"
+__run_sh__bash_libraries_absolute_path=$(cd "$__run_sh__base_path" && cd "$__run_sh__bash_libraries_relative_path" && pwd)
+export PATH="$__run_sh__bash_libraries_absolute_path:$PATH"
+
+source csv_to_dat.sh || exit 1
+source framework.sh || exit 1
+source get_result_count.sh || exit 1
+source panic.sh || exit 1
+source path_join.sh || exit 1
+
+if ! command -v hey > /dev/null; then
+	echo "hey is not present."
+	exit 1
+fi
+
+declare -gi iterations=100000
+declare -ga concurrency=(32 64 128 256)
+
+# Execute the experiments
+# $1 (hostname)
+# $2 (results_directory) - a directory where we will store our results
+run_experiments() {
+	if (($# != 2)); then
+		panic "invalid number of arguments \"$1\""
+		return 1
+	elif [[ -z "$1" ]]; then
+		panic "hostname \"$1\" was empty"
+		return 1
+	elif [[ ! -d "$2" ]]; then
+		panic "directory \"$2\" does not exist"
+		return 1
+	fi
+
+	local hostname="$1"
+	local results_directory="$2"
+
+	printf "Running Experiments:\n"
+	for conn in ${concurrency[*]}; do
+		printf "\t%d Concurrency: " "$conn"
+		hey -disable-compression -disable-keepalive -disable-redirects -n "$iterations" -c "$conn" -cpus 4 -o csv -m GET "http://$hostname:10000" > "$results_directory/con$conn.csv" 2> /dev/null || {
+			printf "[ERR]\n"
+			panic "experiment failed"
+			return 1
+		}
+		get_result_count "$results_directory/con$conn.csv" || {
+			printf "[ERR]\n"
+			panic "con$conn.csv unexpectedly has zero requests"
+			return 1
+		}
+		printf "[OK]\n"
+	done
+
+	return 0
+}
+
+process_results() {
+	if (($# != 1)); then
+		panic "invalid number of arguments ($#, expected 1)"
+		return 1
+	elif ! [[ -d "$1" ]]; then
+		panic "directory $1 does not exist"
+		return 1
+	fi
+
+	local -r results_directory="$1"
+
+	printf "Processing Results: "
+
+	# Write headers to CSVs
+	printf "Concurrency,Success_Rate\n" >> "$results_directory/success.csv"
+	printf "Concurrency,Throughput\n" >> "$results_directory/throughput.csv"
+
+	for conn in ${concurrency[*]}; do
+		if [[ ! -f "$results_directory/con$conn.csv" ]]; then
+			printf "[ERR]\n"
+			panic "Missing $results_directory/con$conn.csv"
+			return 1
+		fi
+
+		# Calculate Success Rate for csv (percent of requests resulting in 200)
+		awk -F, '
+		$7 == 200 {ok++}
+		END{printf "'"$conn"',%3.5f\n", (ok / '"$iterations"' * 100)}
+	' < "$results_directory/con$conn.csv" >> "$results_directory/success.csv"
+
+		# Get Number of 200s
+		oks=$(awk -F, '$7 == 200' < "$results_directory/con$conn.csv" | wc -l)
+		((oks == 0)) && continue # If all errors, skip line
+
+		# We determine duration by looking at the timestamp of the last complete request
+		duration=$(tail -n1 "$results_directory/con$conn.csv" | cut -d, -f8)
+
+		# Throughput is calculated as the mean number of successful completions per second
+		throughput=$(echo "$oks/$duration" | bc)
+		printf "%d,%f\n" "$conn" "$throughput" >> "$results_directory/throughput.csv"
+	done
+
+	# Transform csvs to dat files for gnuplot
+	csv_to_dat "$results_directory/success.csv" "$results_directory/throughput.csv"
+
+	printf "[OK]\n"
+	return 0
+}
+
+# Expected Symbol used by the framework
+experiment_main() {
+	local -r target_hostname="$1"
+	local -r results_directory="$2"
+
+	run_experiments "$target_hostname" "$results_directory" || return 1
+	process_results "$results_directory" || return 1
+
+	return 0
+}
+
+main "$@"
@@ -0,0 +1,12 @@
+reset
+
+set term jpeg 
+set output "hitm.jpg"
+
+set xlabel "Workers"
+set ylabel "HITM Events per Request"
+
+set logscale x 2
+set yrange [0:]
+
+plot 'hitm.dat' using 1:4 title 'HITM/Request' with linespoints
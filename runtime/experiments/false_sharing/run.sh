@@ -0,0 +1,161 @@
+#!/bin/bash
+
+# This experiment is intended to document how much cache line contention between workers grows with the worker count
+# It runs the runtime under perf c2c at increasing worker counts and records the HITM events, loads that hit a line
+# modified in the cache of another core
+
+# Add bash_libraries directory to path
+__run_sh__base_path="$(dirname "$(realpath --logical "${BASH_SOURCE[0]}")")"
+__run_sh__bash_libraries_relative_path="../bash_libraries"
+__run_sh__bash_libraries_absolute_path=$(cd "$__run_sh__base_path" && cd "$__run_sh__bash_libraries_relative_path" && pwd)
+export PATH="$__run_sh__bash_libraries_absolute_path:$PATH"
+
+source csv_to_dat.sh || exit 1
+source generate_gnuplots.sh || exit 1
+source get_result_count.sh || exit 1
+source panic.sh || exit 1
+
+if ! command -v hey > /dev/null; then
+	echo "hey is not present."
+	exit 1
+fi
+
+if ! command -v perf > /dev/null; then
+	echo "perf is not present."
+	exit 1
+fi
+
+declare -gi iterations=100000
+declare -gi concurrency=100
+declare -ga worker_counts=(1 2 4 8 16 32 64)
+
+# Runs the runtime under perf c2c with the given number of workers while hey drives load against it
+# $1 (worker_count)
+# $2 (results_directory)
+run_experiment() {
+	if (($# != 2)); then
+		panic "invalid number of arguments \"$1\""
+		return 1
+	elif [[ ! -d "$2" ]]; then
+		panic "directory \"$2\" does not exist"
+		return 1
+	fi
+
+	local -ir worker_count="$1"
+	local -r results_directory="$2"
+
+	SLEDGE_NWORKERS="$worker_count" perf c2c record -o "$results_directory/perf-$worker_count.data" -- \
+		sledgert "$__run_sh__base_path/spec.json" >> "$results_directory/log-$worker_count.txt" 2>&1 &
+	local -ir perf_pid=$!
+
+	# Allow the runtime to initialize before sending requests
+	sleep 1
+
+	hey -n "$iterations" -c "$concurrency" -cpus 2 -o csv -m GET "http://localhost:10000" > "$results_directory/workers$worker_count.csv" 2> /dev/null
+	local -i hey_rc=$?
+
+	# SIGTERM triggers runtime_cleanup, after which perf writes its data file
+	pkill -SIGTERM sledgert
+	wait "$perf_pid"
+
+	((hey_rc == 0)) || {
+		panic "hey failed"
+		return 1
+	}
+	get_result_count "$results_directory/workers$worker_count.csv" || {
+		panic "workers$worker_count.csv unexpectedly has zero requests"
+		return 1
+	}
+
+	return 0
+}
+
+# Execute the experiments
+# $1 (results_directory) - a directory where we will store our results
+run_experiments() {
+	if (($# != 1)); then
+		panic "invalid number of arguments \"$1\""
+		return 1
+	elif [[ ! -d "$1" ]]; then
+		panic "directory \"$1\" does not exist"
+		return 1
+	fi
+
+	local -r results_directory="$1"
+	local -ir max_worker_count=$(($(nproc) - 2))
+
+	printf "Running Experiments:\n"
+	for worker_count in "${worker_counts[@]}"; do
+		((worker_count > max_worker_count)) && break
+
+		printf "\t%d Workers: " "$worker_count"
+		run_experiment "$worker_count" "$results_directory" || {
+			printf "[ERR]\n"
+			return 1
+		}
+		printf "[OK]\n"
+	done
+
+	return 0
+}
+
+process_results() {
+	if (($# != 1)); then
+		panic "invalid number of arguments ($#, expected 1)"
+		return 1
+	elif ! [[ -d "$1" ]]; then
+		panic "directory $1 does not exist"
+		return 1
+	fi
+
+	local -r results_directory="$1"
+
+	printf "Processing Results: "
+
+	printf "Workers,Local_HITM,Remote_HITM,HITM_per_Request\n" >> "$results_directory/hitm.csv"
+
+	for worker_count in "${worker_counts[@]}"; do
+		[[ -f "$results_directory/perf-$worker_count.data" ]] || continue
+
+		perf c2c report -i "$results_directory/perf-$worker_count.data" --stats --stdio \
+			> "$results_directory/c2c-$worker_count.txt" 2> /dev/null || {
+			printf "[ERR]\n"
+			panic "perf c2c report failed for $worker_count workers"
+			return 1
+		}
+
+		local -i local_hitm remote_hitm oks
+		local_hitm=$(awk -F: '/Load Local HITM/ {gsub(/ /, "", $2); print $2}' < "$results_directory/c2c-$worker_count.txt")
+		remote_hitm=$(awk -F: '/Load Remote HITM/ {gsub(/ /, "", $2); print $2}' < "$results_directory/c2c-$worker_count.txt")
+		oks=$(awk -F, '$7 == 200 {ok++} END{print ok + 0}' < "$results_directory/workers$worker_count.csv")
+		((oks == 0)) && continue
+
+		printf "%d,%d,%d,%f\n" "$worker_count" "$local_hitm" "$remote_hitm" \
+			"$(echo "($local_hitm + $remote_hitm) / $oks" | bc -l)" >> "$results_directory/hitm.csv"
+	done
+
+	# Transform csvs to dat files for gnuplot
+	csv_to_dat "$results_directory/hitm.csv"
+
+	# Generate gnuplots
+	generate_gnuplots "$results_directory" "$__run_sh__base_path" || {
+		printf "[ERR]\n"
+		panic "failed to generate gnuplots"
+	}
+
+	printf "[OK]\n"
+	return 0
+}
+
+main() {
+	local -r results_directory="$__run_sh__base_path/res/$(date +%s)"
+	mkdir -p "$results_directory" || {
+		panic "mkdir -p $results_directory"
+		return 1
+	}
+
+	run_experiments "$results_directory" || exit 1
+	process_results "$results_directory" || exit 1
+}
+
+main "$@"
@@ -5,6 +5,8 @@
 # 	TODO: Does this handle non-200s?
 # Throughput - The mean number of successful requests per second
 # Latency - the rount-trip resonse time (unit?) of successful requests at the p50, p90, p99, and p100 percetiles
+# Deadline Miss Rate - The percentage of requests that fail or do not complete by their deadlines. Compare across the
+# 	*.env variants (EDF, FIFO, LLF, SRPT) in the res/<timestamp>/*/deadline_miss.csv files
 
 # Add bash_libraries directory to path
 __run_sh__base_path="$(dirname "$(realpath --logical "${BASH_SOURCE[0]}")")"
@@ -24,6 +26,11 @@ if ! command -v hey > /dev/null; then
 	exit 1
 fi
 
+if ! command -v jq > /dev/null; then
+	echo "jq is not present."
+	exit 1
+fi
+
 # Sends requests until the per-module perf window buffers are full
 # This ensures that Sledge has accurate estimates of execution time
 run_samples() {
@@ -174,10 +181,38 @@ process_results() {
 	printf "Processing Results: "
 
 	# Write headers to CSVs
+	printf "Payload,Deadline_Miss_Rate\n" >> "$results_directory/deadline_miss.csv"
 	printf "Payload,p50,p90,p99,p100\n" >> "$results_directory/latency.csv"
 
 	local -ar payloads=(fibonacci_10 fibonacci_40)
+
+	# The relative deadline of each workload in ms, scraped from spec.json
+	# Our JSON format is not spec compliant, so wrap it in an array before jq
+	local -A deadlines_ms=()
 	for payload in "${payloads[@]}"; do
+		deadlines_ms[$payload]=$(
+			{
+				echo "["
+				cat "$__run_sh__base_path/spec.json"
+				echo "]"
+			} | jq ".[] | select(.name == \"$payload\") | .\"relative-deadline-us\" / 1000"
+		)
+		if [[ -z "${deadlines_ms[$payload]}" ]]; then
+			panic "relative-deadline-us of $payload is missing from spec.json"
+			return 1
+		fi
+	done
+
+	for payload in "${payloads[@]}"; do
+		local deadline=${deadlines_ms[$payload]}
+
+		# Calculate Deadline Miss Rate for csv (percent of requests that do not return 200 within deadline)
+		# The per-workload csvs have had their headers stripped, so every row is a request
+		awk -F, '
+			$7 == 200 && (($1 - $2) * 1000) <= '"$deadline"' {ok++}
+			END{printf "'"$payload"',%3.5f\n", (NR == 0 ? 0 : (NR - ok) / NR * 100)}
+		' < "$results_directory/$payload.csv" >> "$results_directory/deadline_miss.csv"
+
 
 		# Filter on 200s, subtract DNS time, convert from s to ms, and sort
 		awk -F, '$7 == 200 {print (($1 - $2) * 1000)}' < "$results_directory/$payload.csv" \
@@ -207,7 +242,7 @@ process_results() {
 	done
 
 	# Transform csvs to dat files for gnuplot
-	csv_to_dat "$results_directory/latency.csv"
+	csv_to_dat "$results_directory/deadline_miss.csv" "$results_directory/latency.csv"
 
 	printf "[OK]\n"
 	return 0
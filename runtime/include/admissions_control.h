@@ -5,6 +5,15 @@
 
 #define ADMISSIONS_CONTROL_GRANULARITY 1000000
 
+/* Feedback controller tuning. Capacity is expressed in units of ADMISSIONS_CONTROL_GRANULARITY per worker */
+#define ADMISSIONS_CONTROL_FEEDBACK_PERIOD_US           100000 /* 100ms between adjustments */
+#define ADMISSIONS_CONTROL_FEEDBACK_MIN_COMPLETIONS     16     /* Fewer completions in a period are too noisy */
+#define ADMISSIONS_CONTROL_FEEDBACK_TARGET_MISS_PERMILLE 10    /* Decrease capacity above a 1% miss ratio */
+#define ADMISSIONS_CONTROL_FEEDBACK_QUEUEING_THRESHOLD   (ADMISSIONS_CONTROL_GRANULARITY / 4) /* 25% of deadline */
+#define ADMISSIONS_CONTROL_FEEDBACK_MIN_CAPACITY_PERCENT 10
+
+extern bool admissions_control_feedback_enabled;
+
 void     admissions_control_initialize(void);
 void     admissions_control_add(uint64_t admissions_estimate);
 void     admissions_control_subtract(uint64_t admissions_estimate);
@@ -12,3 +21,4 @@ uint64_t admissions_control_calculate_estimate(uint64_t estimated_execution, uin
 uint64_t admissions_control_calculate_estimate_us(uint32_t estimated_execution_us, uint32_t relative_deadline_us);
 void     admissions_control_log_decision(uint64_t admissions_estimate, bool admitted);
 uint64_t admissions_control_decide(uint64_t admissions_estimate);
+void     admissions_control_record_completion(uint64_t queueing_delay, uint64_t relative_deadline);
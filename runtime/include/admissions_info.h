@@ -1,15 +1,130 @@
 #pragma once
 
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "admissions_control.h"
 #include "perf_window_t.h"
+#include "runtime.h"
+#include "types.h"
 
-struct admissions_info {
+/* Number of completions a worker records before merging the per-worker estimates into the module estimate */
+#define ADMISSIONS_INFO_MERGE_INTERVAL 8
+
+/*
+ * Execution samples are additionally bucketed by request body size so that modules whose execution scales with their
+ * input get an estimate for the size of each request. Bucket 0 holds bodies smaller than the base, and each following
+ * bucket covers sizes ADMISSIONS_INFO_SIZE_BUCKET_FACTOR times larger than the previous. The last bucket is unbounded.
+ */
+#define ADMISSIONS_INFO_SIZE_BUCKET_COUNT  8
+#define ADMISSIONS_INFO_SIZE_BUCKET_BASE   1024 /* bytes */
+#define ADMISSIONS_INFO_SIZE_BUCKET_FACTOR 4
+#define ADMISSIONS_INFO_SIZE_BUCKET_NONE   -1 /* Size unknown, so the module-wide estimate is used */
+
+extern bool admissions_info_size_aware_enabled;
+
+/*
+ * Execution samples recorded by a single worker. Each worker only writes its own entry, so updates do not require a
+ * lock. Entries are cache aligned to avoid false sharing between workers completing sandboxes of the same module.
+ */
+struct admissions_info_worker {
 	struct perf_window perf_window;
-	int                percentile;        /* 50 - 99 */
-	int                control_index;     /* Precomputed Lookup index when perf_window is full */
-	uint64_t           estimate;          /* cycles */
-	uint64_t           relative_deadline; /* Relative deadline in cycles. This is duplicated state */
+	_Atomic uint64_t   estimated_execution; /* cycles. Percentile of this worker's window. 0 if no samples */
+	uint32_t           completion_count;
+
+	/* Size-bucketed samples. Only recorded when admissions_info_size_aware_enabled */
+	struct perf_window size_perf_windows[ADMISSIONS_INFO_SIZE_BUCKET_COUNT];
+	_Atomic uint64_t   size_estimated_execution[ADMISSIONS_INFO_SIZE_BUCKET_COUNT];
+	uint32_t           size_completion_count[ADMISSIONS_INFO_SIZE_BUCKET_COUNT];
+} CACHE_ALIGNED;
+
+struct admissions_info {
+	struct admissions_info_worker *workers;             /* Indexed by worker_thread_idx */
+	int                            percentile;          /* 50 - 99 */
+	int                            control_index;       /* Precomputed Lookup index when perf_window is full */
+	_Atomic uint64_t               estimate;            /* cycles */
+	_Atomic uint64_t               estimated_execution; /* cycles. Used by LLF and SRPT for remaining execution */
+	uint64_t                       relative_deadline;   /* Relative deadline in cycles. This is duplicated state */
+
+	/*
+	 * Merged size-bucketed estimates. 0 if no worker has sampled the bucket yet
+	 * The merged estimates are written by the workers and read by the listener, so they are accessed atomically
+	 */
+	_Atomic uint64_t size_estimate[ADMISSIONS_INFO_SIZE_BUCKET_COUNT];
+	_Atomic uint64_t size_estimated_execution[ADMISSIONS_INFO_SIZE_BUCKET_COUNT]; /* cycles */
 };
 
 void admissions_info_initialize(struct admissions_info *self, int percentile, uint64_t expected_execution,
                                 uint64_t relative_deadline);
-void admissions_info_update(struct admissions_info *self, uint64_t execution_duration);
+void admissions_info_deinitialize(struct admissions_info *self);
+void admissions_info_update(struct admissions_info *self, uint64_t execution_duration, ssize_t payload_size);
+
+/**
+ * Maps a request body size to a size bucket
+ * @param payload_size size in bytes, or a negative value if unknown
+ * @returns the bucket, or ADMISSIONS_INFO_SIZE_BUCKET_NONE if the size is unknown or size-awareness is disabled
+ */
+static inline int
+admissions_info_get_size_bucket(ssize_t payload_size)
+{
+	if (!admissions_info_size_aware_enabled || payload_size < 0) return ADMISSIONS_INFO_SIZE_BUCKET_NONE;
+
+	int    bucket = 0;
+	size_t bound  = ADMISSIONS_INFO_SIZE_BUCKET_BASE;
+	while ((size_t)payload_size >= bound && bucket < ADMISSIONS_INFO_SIZE_BUCKET_COUNT - 1) {
+		bound *= ADMISSIONS_INFO_SIZE_BUCKET_FACTOR;
+		bucket++;
+	}
+	return bucket;
+}
+
+/**
+ * Returns the admissions estimate for a request in the given size bucket, falling back to the module-wide estimate if
+ * the bucket has no samples yet
+ * @param self
+ * @param bucket size bucket or ADMISSIONS_INFO_SIZE_BUCKET_NONE
+ * @returns unitless admissions estimate
+ */
+static inline uint64_t
+admissions_info_get_estimate(struct admissions_info *self, int bucket)
+{
+	if (bucket != ADMISSIONS_INFO_SIZE_BUCKET_NONE) {
+		uint64_t size_estimate = atomic_load_explicit(&self->size_estimate[bucket], memory_order_relaxed);
+		if (size_estimate != 0) return size_estimate;
+	}
+	return atomic_load_explicit(&self->estimate, memory_order_relaxed);
+}
+
+/**
+ * Returns the estimated execution for a request in the given size bucket, falling back to the module-wide estimate if
+ * the bucket has no samples yet
+ * @param self
+ * @param bucket size bucket or ADMISSIONS_INFO_SIZE_BUCKET_NONE
+ * @returns execution estimate in cycles
+ */
+static inline uint64_t
+admissions_info_get_estimated_execution(struct admissions_info *self, int bucket)
+{
+	if (bucket != ADMISSIONS_INFO_SIZE_BUCKET_NONE) {
+		uint64_t size_estimated_execution = atomic_load_explicit(&self->size_estimated_execution[bucket],
+		                                                         memory_order_relaxed);
+		if (size_estimated_execution != 0) return size_estimated_execution;
+	}
+	return atomic_load_explicit(&self->estimated_execution, memory_order_relaxed);
+}
+
+/**
+ * Returns the admissions estimate for a request in the given size bucket with a relative deadline that may be tighter
+ * than that of the module
+ * @param self
+ * @param bucket size bucket or ADMISSIONS_INFO_SIZE_BUCKET_NONE
+ * @param relative_deadline relative deadline of the request in cycles
+ * @returns unitless admissions estimate
+ */
+static inline uint64_t
+admissions_info_get_estimate_for_deadline(struct admissions_info *self, int bucket, uint64_t relative_deadline)
+{
+	if (relative_deadline == self->relative_deadline) return admissions_info_get_estimate(self, bucket);
+	return admissions_control_calculate_estimate(admissions_info_get_estimated_execution(self, bucket),
+	                                             relative_deadline);
+}
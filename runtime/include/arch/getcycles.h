@@ -1,3 +1,12 @@
 #pragma once
 
+#include <stdint.h>
+
 extern unsigned long long int __getcycles(void);
+
+/*
+ * Returns the frequency in Hz at which __getcycles counts, where the hardware reports it, or 0 if it must be measured.
+ * This is the rate of the invariant TSC on x86_64 and of the generic timer on aarch64, neither of which follows the
+ * current clock of a core.
+ */
+extern uint64_t arch_getcycles_frequency_Hz(void);
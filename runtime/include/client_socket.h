@@ -3,7 +3,9 @@
 #include <assert.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -32,10 +34,61 @@ client_socket_close(int client_socket, struct sockaddr *client_address)
 	}
 }
 
+/**
+ * Copies the start of a request into a buffer without consuming it from the socket, so the worker that later services
+ * the request still reads it in full. The socket is nonblocking, so this only sees what has already arrived
+ * @param client_socket
+ * @param buffer destination, NUL-terminated on return
+ * @param buffer_size size of buffer, including space for the terminator
+ * @returns bytes copied, or -1 if nothing was available
+ */
+static inline ssize_t
+client_socket_peek(int client_socket, char *buffer, size_t buffer_size)
+{
+	assert(buffer_size > 0);
+
+	ssize_t length = recv(client_socket, buffer, buffer_size - 1, MSG_PEEK);
+	if (length <= 0) {
+		buffer[0] = '\0';
+		return -1;
+	}
+
+	buffer[length] = '\0';
+	return length;
+}
+
+/**
+ * Finds a header in a peeked request and parses its value as a non-negative integer
+ * @param buffer NUL-terminated request prefix
+ * @param header header name including the trailing colon, such as "Content-Length:". Matched case-insensitively
+ * @returns the value, or -1 if the header is absent, truncated, or malformed
+ */
+static inline long
+client_socket_peek_header_long(const char *buffer, const char *header)
+{
+	/* Headers follow the request line, so only match at the start of a line */
+	size_t      header_length = strlen(header);
+	const char *line          = strstr(buffer, "\r\n");
+	while (line != NULL) {
+		line += 2;
+		if (line[0] == '\r' || line[0] == '\0') break; /* End of headers or of the buffer */
+		if (strncasecmp(line, header, header_length) == 0) {
+			char *end;
+			errno      = 0;
+			long value = strtol(line + header_length, &end, 10);
+			if (errno != 0 || end == line + header_length || value < 0 || *end != '\r') return -1;
+			return value;
+		}
+		line = strstr(line, "\r\n");
+	}
+
+	return -1;
+}
+
 /**
  * Rejects request due to admission control or error
  * @param client_socket - the client we are rejecting
- * @param status_code - either 503 or 400
+ * @param status_code - either 503, 504, or 400
  */
 static inline int
 client_socket_send(int client_socket, int status_code)
@@ -47,6 +100,10 @@ client_socket_send(int client_socket, int status_code)
 		response = HTTP_RESPONSE_503_SERVICE_UNAVAILABLE;
 		http_total_increment_5XX();
 		break;
+	case 504:
+		response = HTTP_RESPONSE_504_GATEWAY_TIMEOUT;
+		http_total_increment_5XX();
+		break;
 	case 400:
 		response = HTTP_RESPONSE_400_BAD_REQUEST;
 		http_total_increment_4XX();
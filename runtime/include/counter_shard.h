@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "runtime.h"
+
+/*
+ * Counters written by the listener and by every worker are sharded by thread, so that incrementing a counter never
+ * touches a cache line written by another core. Readers sum the shards. Shard 0 belongs to the listener thread and to
+ * any other thread that is not a worker, and shard i + 1 belongs to worker i.
+ *
+ * Increments are atomic because a signal handler may interrupt an increment on the same thread, but they are relaxed
+ * and uncontended, so they do not bounce cache lines between cores.
+ */
+extern __thread uint32_t counter_shard_idx;
+
+void *counter_shard_allocate(size_t element_size);
+
+/**
+ * @returns the number of shards of a sharded counter
+ */
+static inline uint32_t
+counter_shard_count(void)
+{
+	return runtime_worker_threads_count + 1;
+}
+
+/**
+ * Adds to the shard of a counter belonging to the calling thread
+ * @param counter
+ * @param value may be negative
+ */
+static inline void
+counter_shard_add(_Atomic int64_t *counter, int64_t value)
+{
+	atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
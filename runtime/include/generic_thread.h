@@ -5,6 +5,7 @@
 extern __thread uint64_t generic_thread_lock_duration;
 extern __thread uint64_t generic_thread_lock_longest;
 extern __thread uint64_t generic_thread_start_timestamp;
+extern __thread uint32_t generic_thread_locks_held;
 
 void generic_thread_dump_lock_overhead(void);
 void generic_thread_initialize(void);
@@ -4,17 +4,26 @@
 
 #include "sandbox_request.h"
 
-/* Returns pointer back if successful, null otherwise */
-typedef struct sandbox_request *(*global_request_scheduler_add_fn_t)(void *);
-typedef int (*global_request_scheduler_remove_fn_t)(struct sandbox_request **);
-typedef int (*global_request_scheduler_remove_if_earlier_fn_t)(struct sandbox_request **, uint64_t);
-typedef uint64_t (*global_request_scheduler_peek_fn_t)(void);
+/* Upper bound on the number of requests a worker pulls from the global request scheduler at once */
+#define GLOBAL_REQUEST_SCHEDULER_BATCH_SIZE_MAX 8
+
+/*
+ * Each worker pool has its own instance of the variant. The first argument of each function is the index of the pool.
+ * Returns pointer back if successful, null otherwise
+ */
+typedef struct sandbox_request *(*global_request_scheduler_add_fn_t)(uint32_t, void *);
+typedef int (*global_request_scheduler_remove_fn_t)(uint32_t, struct sandbox_request **);
+typedef int (*global_request_scheduler_remove_if_earlier_fn_t)(uint32_t, struct sandbox_request **, uint64_t);
+typedef int (*global_request_scheduler_remove_batch_if_earlier_fn_t)(uint32_t, struct sandbox_request **, int,
+                                                                     uint64_t, uint64_t);
+typedef uint64_t (*global_request_scheduler_peek_fn_t)(uint32_t);
 
 struct global_request_scheduler_config {
-	global_request_scheduler_add_fn_t               add_fn;
-	global_request_scheduler_remove_fn_t            remove_fn;
-	global_request_scheduler_remove_if_earlier_fn_t remove_if_earlier_fn;
-	global_request_scheduler_peek_fn_t              peek_fn;
+	global_request_scheduler_add_fn_t                     add_fn;
+	global_request_scheduler_remove_fn_t                  remove_fn;
+	global_request_scheduler_remove_if_earlier_fn_t       remove_if_earlier_fn;
+	global_request_scheduler_remove_batch_if_earlier_fn_t remove_batch_if_earlier_fn;
+	global_request_scheduler_peek_fn_t                    peek_fn;
 };
 
 
@@ -22,4 +31,8 @@ void                    global_request_scheduler_initialize(struct global_reques
 struct sandbox_request *global_request_scheduler_add(struct sandbox_request *);
 int                     global_request_scheduler_remove(struct sandbox_request **);
 int                     global_request_scheduler_remove_if_earlier(struct sandbox_request **, uint64_t targed_deadline);
+int                     global_request_scheduler_remove_batch_if_earlier(struct sandbox_request **, int max_count,
+                                                                         uint64_t target_deadline,
+                                                                         uint64_t batch_window);
 uint64_t                global_request_scheduler_peek(void);
+uint64_t                global_request_scheduler_peek_pool(uint32_t pool_idx);
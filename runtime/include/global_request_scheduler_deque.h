@@ -2,4 +2,4 @@
 
 #include "global_request_scheduler.h"
 
-void global_request_scheduler_deque_initialize();
+void global_request_scheduler_deque_initialize(uint32_t pool_idx);
@@ -1,5 +1,10 @@
 #pragma once
 
 #include "global_request_scheduler.h"
+#include "priority_queue.h"
 
-void global_request_scheduler_minheap_initialize();
+/* Maximum number of infeasible requests removed by a single sweep of the global request scheduler */
+#define GLOBAL_REQUEST_SCHEDULER_MINHEAP_DROP_BATCH_SIZE 64
+
+int  global_request_scheduler_minheap_drop_infeasible(uint32_t pool_idx);
+void global_request_scheduler_minheap_initialize(uint32_t pool_idx, priority_queue_get_priority_fn_t get_priority_fn);
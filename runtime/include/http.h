@@ -3,10 +3,16 @@
 #define HTTP_MAX_HEADER_COUNT        16
 #define HTTP_MAX_HEADER_LENGTH       32
 #define HTTP_MAX_HEADER_VALUE_LENGTH 64
+#define HTTP_PEEK_BUFFER_SIZE        1024 /* Bytes of a request inspected by the listener before admission */
+#define HTTP_PEEK_TIMEOUT_US         200  /* How long the listener waits for the headers of a request to arrive */
+
+#define HTTP_REQUEST_CONTENT_LENGTH "Content-Length:"
+#define HTTP_REQUEST_DEADLINE_US    "X-Sledge-Deadline-Us:" /* Remaining end-to-end budget of the caller */
 
 #define HTTP_RESPONSE_200_OK                    "HTTP/1.1 200 OK\r\n"
 #define HTTP_RESPONSE_503_SERVICE_UNAVAILABLE   "HTTP/1.1 503 Service Unavailable\r\n\r\n"
 #define HTTP_RESPONSE_400_BAD_REQUEST           "HTTP/1.1 400 Bad Request\r\n\r\n"
+#define HTTP_RESPONSE_504_GATEWAY_TIMEOUT       "HTTP/1.1 504 Gateway Timeout\r\n\r\n"
 #define HTTP_RESPONSE_CONTENT_LENGTH            "Content-Length: "
 #define HTTP_RESPONSE_CONTENT_LENGTH_TERMINATOR "\r\n\r\n" /* content body follows this */
 #define HTTP_RESPONSE_CONTENT_TYPE              "Content-Type: "
@@ -3,55 +3,54 @@
 #include <stdatomic.h>
 #include <stdint.h>
 
+#include "counter_shard.h"
+#include "types.h"
+
 /*
  * Counts to track requests and responses
- * requests and 5XX (admissions control rejections) are only tracked by the listener core, so they are not
- * behind a compiler flag. 2XX and 4XX can be incremented by worker cores, so they are behind a flag because
- * of concerns about contention
+ * Requests and rejections are counted by the listener, and responses by workers, so the counts are sharded by thread
+ * and summed when read. See counter_shard.h
  */
-extern _Atomic uint32_t http_total_requests;
-extern _Atomic uint32_t http_total_5XX;
-
-#ifdef LOG_TOTAL_REQS_RESPS
-extern _Atomic uint32_t http_total_2XX;
-extern _Atomic uint32_t http_total_4XX;
-#endif
-
-static inline void
-http_total_init()
-{
-	atomic_init(&http_total_requests, 0);
-	atomic_init(&http_total_5XX, 0);
-#ifdef LOG_TOTAL_REQS_RESPS
-	atomic_init(&http_total_2XX, 0);
-	atomic_init(&http_total_4XX, 0);
-#endif
-}
+struct http_total_shard {
+	_Atomic int64_t requests;
+	_Atomic int64_t responses_2XX;
+	_Atomic int64_t responses_4XX;
+	_Atomic int64_t responses_5XX;
+} CACHE_ALIGNED;
+
+/* Sums of the shards */
+struct http_total {
+	int64_t requests;
+	int64_t responses_2XX;
+	int64_t responses_4XX;
+	int64_t responses_5XX;
+};
+
+extern struct http_total_shard *http_total_shards;
+
+void http_total_init(void);
+void http_total_sum(struct http_total *total);
 
 static inline void
 http_total_increment_request()
 {
-	atomic_fetch_add(&http_total_requests, 1);
+	counter_shard_add(&http_total_shards[counter_shard_idx].requests, 1);
 }
 
 static inline void
 http_total_increment_2xx()
 {
-#ifdef LOG_TOTAL_REQS_RESPS
-	atomic_fetch_add(&http_total_2XX, 1);
-#endif
+	counter_shard_add(&http_total_shards[counter_shard_idx].responses_2XX, 1);
 }
 
 static inline void
 http_total_increment_4XX()
 {
-#ifdef LOG_TOTAL_REQS_RESPS
-	atomic_fetch_add(&http_total_4XX, 1);
-#endif
+	counter_shard_add(&http_total_shards[counter_shard_idx].responses_4XX, 1);
 }
 
 static inline void
 http_total_increment_5XX()
 {
-	atomic_fetch_add(&http_total_5XX, 1);
+	counter_shard_add(&http_total_shards[counter_shard_idx].responses_5XX, 1);
 }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Log-linear latency histogram in the style of HdrHistogram. Values below LATENCY_HISTOGRAM_SUB_BUCKET_COUNT have a
+ * bucket each. Above that, each power of two is split into LATENCY_HISTOGRAM_SUB_BUCKET_COUNT linear sub-buckets, so
+ * a bucket is never wider than 1/LATENCY_HISTOGRAM_SUB_BUCKET_COUNT of the values it holds. Values are clamped to
+ * UINT32_MAX.
+ *
+ * A histogram has a single writer. Buckets are atomics only so that a reader on another thread never observes a torn
+ * count. Readers merge the histograms of all writers and may see a sample in one bucket before the matching sum.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS  4
+#define LATENCY_HISTOGRAM_SUB_BUCKET_COUNT (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_MAGNITUDE_COUNT  (32 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1)
+#define LATENCY_HISTOGRAM_BUCKET_COUNT     (LATENCY_HISTOGRAM_MAGNITUDE_COUNT * LATENCY_HISTOGRAM_SUB_BUCKET_COUNT)
+
+struct latency_histogram {
+	_Atomic uint64_t buckets[LATENCY_HISTOGRAM_BUCKET_COUNT];
+	_Atomic uint64_t sum;
+};
+
+/**
+ * @param value
+ * @returns the index of the bucket holding value
+ */
+static inline int
+latency_histogram_get_bucket(uint32_t value)
+{
+	if (value < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) return value;
+
+	int magnitude  = 31 - __builtin_clz(value);
+	int shift      = magnitude - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+	int sub_bucket = (value >> shift) - LATENCY_HISTOGRAM_SUB_BUCKET_COUNT;
+	return (shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket;
+}
+
+/**
+ * @param bucket
+ * @returns the largest value held by bucket
+ */
+static inline uint32_t
+latency_histogram_get_bucket_max(int bucket)
+{
+	if (bucket < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) return bucket;
+
+	int      shift = bucket / LATENCY_HISTOGRAM_SUB_BUCKET_COUNT - 1;
+	uint64_t start = (uint64_t)(LATENCY_HISTOGRAM_SUB_BUCKET_COUNT + bucket % LATENCY_HISTOGRAM_SUB_BUCKET_COUNT)
+	                 << shift;
+	return (uint32_t)(start + (1UL << shift) - 1);
+}
+
+/**
+ * Records a value. Only the owner of the histogram may call this
+ * @param self
+ * @param value
+ */
+static inline void
+latency_histogram_record(struct latency_histogram *self, uint64_t value)
+{
+	if (value > UINT32_MAX) value = UINT32_MAX;
+
+	_Atomic uint64_t *bucket = &self->buckets[latency_histogram_get_bucket((uint32_t)value)];
+	atomic_store_explicit(bucket, atomic_load_explicit(bucket, memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_store_explicit(&self->sum, atomic_load_explicit(&self->sum, memory_order_relaxed) + value,
+	                      memory_order_relaxed);
+}
+
+/**
+ * Adds the samples of a histogram owned by another thread to a private histogram
+ * @param self private histogram
+ * @param other
+ */
+static inline void
+latency_histogram_merge(struct latency_histogram *self, struct latency_histogram *other)
+{
+	for (int i = 0; i < LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+		self->buckets[i] += atomic_load_explicit(&other->buckets[i], memory_order_relaxed);
+	}
+	self->sum += atomic_load_explicit(&other->sum, memory_order_relaxed);
+}
+
+/**
+ * @param self private histogram
+ * @returns the number of samples
+ */
+static inline uint64_t
+latency_histogram_get_count(struct latency_histogram *self)
+{
+	uint64_t count = 0;
+	for (int i = 0; i < LATENCY_HISTOGRAM_BUCKET_COUNT; i++) count += self->buckets[i];
+	return count;
+}
+
+/**
+ * Returns the value at a quantile, rounded up to the largest value of its bucket
+ * @param self private histogram
+ * @param count number of samples, as returned by latency_histogram_get_count
+ * @param quantile between 0 and 1
+ * @returns the value, or 0 if there are no samples
+ */
+static inline uint32_t
+latency_histogram_get_quantile(struct latency_histogram *self, uint64_t count, double quantile)
+{
+	if (count == 0) return 0;
+
+	/* Nearest rank, which is the smallest rank covering the quantile */
+	uint64_t rank = (uint64_t)(quantile * count);
+	if (rank < quantile * count || rank == 0) rank++;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+		seen += self->buckets[i];
+		if (seen >= rank) return latency_histogram_get_bucket_max(i);
+	}
+	return UINT32_MAX;
+}
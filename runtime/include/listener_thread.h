@@ -1,12 +1,27 @@
 #pragma once
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "generic_thread.h"
 #include "module.h"
 
-#define LISTENER_THREAD_CORE_ID 1
+/* How far the listener got when peeking at the headers of a request */
+enum listener_thread_peek_outcome
+{
+	LISTENER_THREAD_PEEK_COMPLETE = 0, /* Found the end of the headers */
+	LISTENER_THREAD_PEEK_TRUNCATED,    /* The headers did not fit in the peek buffer */
+	LISTENER_THREAD_PEEK_TIMED_OUT,    /* The headers did not arrive within HTTP_PEEK_TIMEOUT_US */
+	LISTENER_THREAD_PEEK_OUTCOME_COUNT
+};
+
+extern const char *listener_thread_peek_outcome_labels[LISTENER_THREAD_PEEK_OUTCOME_COUNT];
+
+/* Only written by the listener thread */
+extern _Atomic uint64_t listener_thread_peek_outcomes[LISTENER_THREAD_PEEK_OUTCOME_COUNT];
 
+extern uint32_t  listener_thread_core_id;
 extern pthread_t listener_thread_id;
 
 void                            listener_thread_initialize(void);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "sandbox_request.h"
+
+void local_rejection_queue_add(struct sandbox_request *sandbox_request, int status_code);
+void local_rejection_queue_drain();
@@ -9,16 +9,22 @@ typedef void (*local_runqueue_add_fn_t)(struct sandbox *);
 typedef bool (*local_runqueue_is_empty_fn_t)(void);
 typedef void (*local_runqueue_delete_fn_t)(struct sandbox *sandbox);
 typedef struct sandbox *(*local_runqueue_get_next_fn_t)();
+typedef void (*local_runqueue_update_fn_t)(struct sandbox *sandbox);
 
 struct local_runqueue_config {
 	local_runqueue_add_fn_t      add_fn;
 	local_runqueue_is_empty_fn_t is_empty_fn;
 	local_runqueue_delete_fn_t   delete_fn;
 	local_runqueue_get_next_fn_t get_next_fn;
+	local_runqueue_update_fn_t   update_fn; /* Optional. NULL if the variant has no priorities to reorder by */
+	/* Priorities depend on running_duration, so they change whenever a sandbox runs */
+	bool is_priority_dynamic;
 };
 
 void            local_runqueue_add(struct sandbox *);
 void            local_runqueue_delete(struct sandbox *);
 bool            local_runqueue_is_empty();
 struct sandbox *local_runqueue_get_next();
+void            local_runqueue_update(struct sandbox *);
+bool            local_runqueue_is_priority_dynamic();
 void            local_runqueue_initialize(struct local_runqueue_config *config);
@@ -1,3 +1,7 @@
 #pragma once
 
-void local_runqueue_minheap_initialize();
+#include <stdbool.h>
+
+#include "priority_queue.h"
+
+void local_runqueue_minheap_initialize(priority_queue_get_priority_fn_t get_priority_fn, bool is_priority_dynamic);
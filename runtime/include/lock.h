@@ -4,15 +4,31 @@
 #include <stdint.h>
 
 #include "arch/getcycles.h"
+#include "generic_thread.h"
+#include "lock_profile.h"
 #include "runtime.h"
 
-typedef ck_spinlock_mcs_t lock_t;
+typedef struct {
+	ck_spinlock_mcs_t    queue;
+	struct lock_profile *profile; /* NULL unless registered with lock_profile_register */
+} lock_t;
+
+/**
+ * Initializes a lock without a profile
+ * @param self
+ */
+static inline void
+lock_initialize(lock_t *self)
+{
+	ck_spinlock_mcs_init(&self->queue);
+	self->profile = NULL;
+}
 
 /**
  * Initializes a lock of type lock_t
  * @param lock - the address of the lock
  */
-#define LOCK_INIT(lock) ck_spinlock_mcs_init((lock))
+#define LOCK_INIT(lock) lock_initialize((lock))
 
 /**
  * Checks if a lock is locked
@@ -20,10 +36,10 @@ typedef ck_spinlock_mcs_t lock_t;
  * @returns bool if lock is locked
  */
 
-#define LOCK_IS_LOCKED(lock) ck_spinlock_mcs_locked((lock))
+#define LOCK_IS_LOCKED(lock) ck_spinlock_mcs_locked(&(lock)->queue)
 
 /**
- * Locks a lock, keeping track of overhead
+ * Locks a lock, keeping track of overhead, and of the contention of the lock if it is profiled
  * @param lock - the address of the lock
  * @param unique_variable_name - a unique prefix to hygienically namespace an associated lock/unlock pair
  */
@@ -31,20 +47,23 @@ typedef ck_spinlock_mcs_t lock_t;
 #define LOCK_LOCK_WITH_BOOKKEEPING(lock, unique_variable_name)                                                         \
 	struct ck_spinlock_mcs _hygiene_##unique_variable_name##_node;                                                 \
 	uint64_t               _hygiene_##unique_variable_name##_pre = __getcycles();                                  \
-	ck_spinlock_mcs_lock((lock), &(_hygiene_##unique_variable_name##_node));                                       \
+	ck_spinlock_mcs_lock(&(lock)->queue, &(_hygiene_##unique_variable_name##_node));                               \
 	uint64_t _hygiene_##unique_variable_name##_duration = (__getcycles() - _hygiene_##unique_variable_name##_pre); \
 	if (_hygiene_##unique_variable_name##_duration > generic_thread_lock_longest) {                                \
 		generic_thread_lock_longest = _hygiene_##unique_variable_name##_duration;                              \
 	}                                                                                                              \
-	generic_thread_lock_duration += _hygiene_##unique_variable_name##_duration;
+	generic_thread_lock_duration += _hygiene_##unique_variable_name##_duration;                                    \
+	generic_thread_locks_held++;                                                                                   \
+	if ((lock)->profile != NULL) lock_profile_record((lock)->profile, _hygiene_##unique_variable_name##_duration);
 
 /**
  * Unlocks a lock
  * @param lock - the address of the lock
  * @param unique_variable_name - a unique prefix to hygienically namespace an associated lock/unlock pair
  */
-#define LOCK_UNLOCK_WITH_BOOKKEEPING(lock, unique_variable_name) \
-	ck_spinlock_mcs_unlock(lock, &(_hygiene_##unique_variable_name##_node));
+#define LOCK_UNLOCK_WITH_BOOKKEEPING(lock, unique_variable_name)                           \
+	ck_spinlock_mcs_unlock(&(lock)->queue, &(_hygiene_##unique_variable_name##_node)); \
+	generic_thread_locks_held--;
 
 /**
  * Locks a lock, keeping track of overhead
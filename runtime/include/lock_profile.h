@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "counter_shard.h"
+#include "latency_histogram.h"
+#include "types.h"
+
+#define LOCK_PROFILE_INSTANCE_MAX_LENGTH 32
+
+/*
+ * Optional contention profile of a lock, enabled with SLEDGE_LOCK_PROFILE. A profile names the site of the lock, which
+ * is the structure it protects such as "module_concurrency", and its instance, such as the name of the module, so
+ * waits are attributed to the lock they were spent on rather than only to the thread that waited.
+ *
+ * Each acquisition of a profiled lock records the cycles spent waiting for it to a histogram of the counter shard of
+ * the calling thread. The acquisition is already timed for generic_thread_lock_duration, so profiling adds two stores
+ * to a cache line written by no other core.
+ *
+ * Locks are MCS locks, so a signal handler that takes a lock held by the thread it interrupted deadlocks. The SIGALRM
+ * handler only takes locks when it preempts a sandbox, which holds none, so a sample is never recorded while another
+ * sample of the same thread is being recorded. The handler asserts that generic_thread_locks_held is 0.
+ */
+struct lock_profile_shard {
+	struct latency_histogram wait; /* cycles */
+} CACHE_ALIGNED;
+
+struct lock_profile {
+	const char *               site;
+	char                       instance[LOCK_PROFILE_INSTANCE_MAX_LENGTH];
+	struct lock_profile_shard *shards; /* Indexed by counter_shard_idx */
+	struct lock_profile *      next;
+};
+
+/**
+ * Called for each registered profile with the waits of all shards merged
+ * @param profile
+ * @param merged wait histogram in cycles
+ * @param argument
+ */
+typedef void (*lock_profile_visit_fn_t)(struct lock_profile *profile, struct latency_histogram *merged,
+                                        void *argument);
+
+extern bool lock_profile_enabled;
+
+void lock_profile_register(struct lock_profile **profile, const char *site, const char *instance);
+void lock_profile_unregister(struct lock_profile **profile);
+void lock_profile_visit(lock_profile_visit_fn_t visit_fn, void *argument);
+void lock_profile_print(void);
+
+/**
+ * Records the wait of the calling thread for a profiled lock
+ * @param self
+ * @param wait cycles
+ */
+static inline void
+lock_profile_record(struct lock_profile *self, uint64_t wait)
+{
+	latency_histogram_record(&self->shards[counter_shard_idx].wait, wait);
+}
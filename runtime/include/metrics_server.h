@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Bytes of a scrape request that are read. The rest of the request is ignored */
+#define METRICS_SERVER_REQUEST_BUFFER_SIZE 1024
+
+/* How long a client may take to send its request or receive the metrics before it is dropped */
+#define METRICS_SERVER_SOCKET_TIMEOUT_MS 1000
+
+extern int metrics_server_port;
+
+void metrics_server_initialize(void);
+
+/**
+ * @returns true if SLEDGE_METRICS_PORT configured an admin port for metrics
+ */
+static inline bool
+metrics_server_is_enabled(void)
+{
+	return metrics_server_port > 0;
+}
@@ -8,7 +8,13 @@
 #include "admissions_control.h"
 #include "admissions_info.h"
 #include "http.h"
+#include "module_concurrency.h"
+#include "module_latency.h"
+#include "module_memory_profile.h"
+#include "module_reservation.h"
+#include "module_slo.h"
 #include "panic.h"
+#include "perf_counters.h"
 #include "types.h"
 
 /* Wasm initialization functions generated by the compiler */
@@ -54,7 +60,16 @@ struct module {
 	struct sockaddr_in          socket_address;
 	int                         socket_descriptor;
 	struct admissions_info      admissions_info;
+	struct module_reservation   reservation;
+	struct module_concurrency   concurrency;
+	struct module_latency       latency;
+	struct module_slo           slo;
 	int                         port;
+	uint32_t                    pool_idx; /* Worker pool that executes this module */
+
+	/* Profiles of completed sandboxes, recorded per worker */
+	struct module_memory_profile        memory_profile;
+	struct perf_counters_module_worker *perf_counters; /* NULL unless SLEDGE_PERF_COUNTERS is set */
 
 	unsigned long max_request_size;
 	char          request_headers[HTTP_MAX_HEADER_COUNT][HTTP_MAX_HEADER_LENGTH];
@@ -201,5 +216,7 @@ module_release(struct module *module)
 void           module_free(struct module *module);
 struct module *module_new(char *mod_name, char *mod_path, int32_t argument_count, uint32_t stack_sz, uint32_t max_heap,
                           uint32_t relative_deadline_us, int port, int req_sz, int resp_sz, int admissions_percentile,
-                          uint32_t expected_execution_us);
+                          uint32_t expected_execution_us, uint32_t reservation_budget_us,
+                          uint32_t reservation_period_us, uint32_t max_concurrency, uint32_t max_queued,
+                          uint32_t pool_idx, uint32_t slo_miss_permille);
 int            module_new_from_json(char *filename);
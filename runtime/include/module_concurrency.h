@@ -0,0 +1,82 @@
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "generic_thread.h"
+#include "lock.h"
+
+struct sandbox_request;
+
+enum MODULE_CONCURRENCY_ADMIT
+{
+	MODULE_CONCURRENCY_ADMIT_RELEASED = 0, /* Handed to the global request scheduler */
+	MODULE_CONCURRENCY_ADMIT_QUEUED   = 1, /* Waiting in the module's queue for a slot */
+	MODULE_CONCURRENCY_ADMIT_FULL     = 2  /* Both the slots and the queue are full. The caller must reject */
+};
+
+/*
+ * Caps the number of requests of a module that are in the global request scheduler or executing at once
+ *
+ * A request holds a slot from the time it is handed to the global request scheduler until its sandbox completes or
+ * errors, or the request is rejected by a worker. Requests that arrive while all slots are held wait in a bounded FIFO
+ * ring buffer and are handed to the global request scheduler as slots are released. A max_concurrency of 0 means the
+ * module is unlimited.
+ */
+struct module_concurrency {
+	uint32_t                 max_concurrency;
+	uint32_t                 max_queued;
+	uint32_t                 concurrency; /* Slots currently held */
+	uint32_t                 queued_head; /* Index of the oldest queued request */
+	uint32_t                 queued_count;
+	struct sandbox_request **queued; /* Ring buffer of max_queued requests */
+	lock_t                   lock;
+};
+
+/**
+ * Initializes the concurrency limits of a module
+ * @param self
+ * @param max_concurrency 0 disables the limit
+ * @param max_queued requests that may wait for a slot before further requests are rejected
+ * @returns 0 on success, -1 if the queue could not be allocated
+ */
+static inline int
+module_concurrency_initialize(struct module_concurrency *self, uint32_t max_concurrency, uint32_t max_queued)
+{
+	assert(self != NULL);
+	assert(max_concurrency > 0 || max_queued == 0);
+
+	LOCK_INIT(&self->lock);
+	self->max_concurrency = max_concurrency;
+	self->max_queued      = max_queued;
+	self->concurrency     = 0;
+	self->queued_head     = 0;
+	self->queued_count    = 0;
+	self->queued          = NULL;
+
+	if (max_queued > 0) {
+		self->queued = (struct sandbox_request **)calloc(max_queued, sizeof(struct sandbox_request *));
+		if (self->queued == NULL) return -1;
+	}
+
+	return 0;
+}
+
+static inline bool
+module_concurrency_is_enabled(struct module_concurrency *self)
+{
+	return self->max_concurrency > 0;
+}
+
+static inline void
+module_concurrency_deinitialize(struct module_concurrency *self)
+{
+	free(self->queued);
+	self->queued = NULL;
+}
+
+enum MODULE_CONCURRENCY_ADMIT module_concurrency_admit(struct module_concurrency *self,
+                                                       struct sandbox_request *   sandbox_request);
+void                          module_concurrency_release(struct module_concurrency *self);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include "runtime.h"
+#include "types.h"
+
+enum module_latency_metric
+{
+	MODULE_LATENCY_END_TO_END = 0, /* From request arrival to response */
+	MODULE_LATENCY_QUEUED,         /* From request arrival to sandbox allocation */
+	MODULE_LATENCY_RUNNING,
+	MODULE_LATENCY_BLOCKED,
+	MODULE_LATENCY_METRIC_COUNT
+};
+
+extern const char *module_latency_metric_labels[MODULE_LATENCY_METRIC_COUNT];
+
+/*
+ * Latency histograms in microseconds recorded by a single worker. Each worker only writes its own entry, and the
+ * metrics server merges the entries of all workers when it is scraped
+ */
+struct module_latency_worker {
+	struct latency_histogram histograms[MODULE_LATENCY_METRIC_COUNT];
+} CACHE_ALIGNED;
+
+struct module_latency {
+	/* Indexed by worker_thread_idx. NULL if the metrics server is disabled */
+	struct module_latency_worker *workers;
+};
+
+void module_latency_initialize(struct module_latency *self);
+void module_latency_deinitialize(struct module_latency *self);
+void module_latency_merge(struct module_latency *self, struct latency_histogram merged[MODULE_LATENCY_METRIC_COUNT]);
+
+/**
+ * Records the latencies of a completed sandbox to the histograms of the calling worker
+ * @param self
+ * @param worker_idx index of the calling worker
+ * @param durations in cycles, indexed by enum module_latency_metric
+ */
+static inline void
+module_latency_record(struct module_latency *self, int worker_idx, uint64_t durations[MODULE_LATENCY_METRIC_COUNT])
+{
+	if (self->workers == NULL) return;
+
+	struct module_latency_worker *worker = &self->workers[worker_idx];
+	for (int i = 0; i < MODULE_LATENCY_METRIC_COUNT; i++) {
+		latency_histogram_record(&worker->histograms[i], durations[i] / runtime_processor_speed_MHz);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include "runtime.h"
+#include "types.h"
+
+enum module_memory_profile_metric
+{
+	MODULE_MEMORY_PROFILE_PAGES = 0,       /* Pages of linear memory at completion, which is the peak */
+	MODULE_MEMORY_PROFILE_GROWTH_PAGES,    /* Pages added by expand_memory */
+	MODULE_MEMORY_PROFILE_GROWTH_DURATION, /* Time spent in expand_memory */
+	MODULE_MEMORY_PROFILE_METRIC_COUNT
+};
+
+extern const char *module_memory_profile_metric_labels[MODULE_MEMORY_PROFILE_METRIC_COUNT];
+
+/*
+ * Histograms of the linear memory of completed sandboxes recorded by a single worker, used to size the initial pages
+ * and memory pools of a module. Each worker only writes its own entry, and the metrics server merges the entries of
+ * all workers when it is scraped
+ */
+struct module_memory_profile_worker {
+	struct latency_histogram histograms[MODULE_MEMORY_PROFILE_METRIC_COUNT];
+} CACHE_ALIGNED;
+
+struct module_memory_profile {
+	/* Indexed by worker_thread_idx. NULL if the metrics server is disabled */
+	struct module_memory_profile_worker *workers;
+};
+
+void module_memory_profile_initialize(struct module_memory_profile *self);
+void module_memory_profile_deinitialize(struct module_memory_profile *self);
+void module_memory_profile_merge(struct module_memory_profile *self,
+                                 struct latency_histogram      merged[MODULE_MEMORY_PROFILE_METRIC_COUNT]);
+
+/**
+ * Records the linear memory of a completed sandbox to the histograms of the calling worker
+ * @param self
+ * @param worker_idx index of the calling worker
+ * @param linear_memory_size in bytes
+ * @param growth_count pages added by expand_memory
+ * @param growth_duration cycles spent in expand_memory
+ */
+static inline void
+module_memory_profile_record(struct module_memory_profile *self, int worker_idx, uint64_t linear_memory_size,
+                             uint64_t growth_count, uint64_t growth_duration)
+{
+	if (self->workers == NULL) return;
+
+	struct latency_histogram *histograms = self->workers[worker_idx].histograms;
+	latency_histogram_record(&histograms[MODULE_MEMORY_PROFILE_PAGES], linear_memory_size / WASM_PAGE_SIZE);
+	latency_histogram_record(&histograms[MODULE_MEMORY_PROFILE_GROWTH_PAGES], growth_count);
+	latency_histogram_record(&histograms[MODULE_MEMORY_PROFILE_GROWTH_DURATION],
+	                         growth_duration * 1000 / runtime_processor_speed_MHz);
+}
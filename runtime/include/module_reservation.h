@@ -0,0 +1,142 @@
+#pragma once
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A Constant Bandwidth Server (CBS) guaranteeing a module budget cycles of execution every period cycles
+ *
+ * Sandboxes of a reserved module are scheduled by the deadline of the server. When the module exhausts its budget, the
+ * budget is recharged and the server deadline is postponed by a period, pushing the module behind other work instead
+ * of letting a burst crowd out other modules. A budget of 0 means the module has no reservation.
+ *
+ * The server is charged from the SIGALRM handler when a sandbox is preempted, so it is lock-free. Rather than a
+ * remaining budget and a deadline that would have to change together, the server keeps the execution consumed since
+ * it was last replenished, from which both are derived. Each exhausted budget postpones the deadline by a period:
+ *
+ *   deadline         = replenish_deadline + consumed / budget * period
+ *   remaining budget = budget - consumed % budget
+ *
+ * The server is only replenished when it is idle, meaning no admitted request of the module is outstanding, so no
+ * sandbox of the module can be charged concurrently with a replenish.
+ */
+struct module_reservation {
+	uint64_t         budget;             /* cycles */
+	uint64_t         period;             /* cycles */
+	_Atomic uint64_t consumed;           /* cycles executed since the last replenish */
+	_Atomic uint64_t replenish_deadline; /* cycles. Absolute deadline of the server at the last replenish */
+	_Atomic uint32_t outstanding;        /* Requests admitted and not yet completed, errored, or rejected */
+};
+
+/**
+ * Initializes a module reservation
+ * @param self
+ * @param budget execution budget per period in cycles. 0 disables the reservation
+ * @param period replenishment period in cycles
+ */
+static inline void
+module_reservation_initialize(struct module_reservation *self, uint64_t budget, uint64_t period)
+{
+	assert(self != NULL);
+	assert(budget <= period);
+
+	self->budget = budget;
+	self->period = period;
+	atomic_init(&self->consumed, 0);
+	atomic_init(&self->replenish_deadline, 0);
+	atomic_init(&self->outstanding, 0);
+}
+
+static inline bool
+module_reservation_is_enabled(struct module_reservation *self)
+{
+	return self->budget > 0;
+}
+
+/**
+ * @param self
+ * @param consumed cycles executed since the last replenish
+ * @returns the absolute deadline of the server in cycles
+ */
+static inline uint64_t
+module_reservation_get_server_deadline(struct module_reservation *self, uint64_t consumed)
+{
+	return atomic_load_explicit(&self->replenish_deadline, memory_order_acquire)
+	       + consumed / self->budget * self->period;
+}
+
+/**
+ * Assigns the scheduling deadline of a newly arrived request. If the server is idle, the CBS arrival rule applies: if
+ * the server deadline has passed or the remaining budget would exceed the reserved bandwidth over the time left until
+ * it, the server is replenished with a fresh budget and a deadline one period from now. Otherwise the request inherits
+ * the current server deadline.
+ *
+ * Called by the listener. Every request passed through here must later be released with module_reservation_release
+ * @param self
+ * @param now arrival timestamp in cycles
+ * @param absolute_deadline the deadline derived from the module's relative deadline
+ * @returns the later of absolute_deadline and the server deadline
+ */
+static inline uint64_t
+module_reservation_get_deadline(struct module_reservation *self, uint64_t now, uint64_t absolute_deadline)
+{
+	if (!module_reservation_is_enabled(self)) return absolute_deadline;
+
+	/* Acquire the charges of the sandboxes that released the server */
+	bool     is_idle  = atomic_fetch_add_explicit(&self->outstanding, 1, memory_order_acquire) == 0;
+	uint64_t consumed = atomic_load_explicit(&self->consumed, memory_order_relaxed);
+	uint64_t deadline = module_reservation_get_server_deadline(self, consumed);
+
+	if (is_idle) {
+		uint64_t remaining_budget = self->budget - consumed % self->budget;
+		if (now >= deadline
+		    || (double)remaining_budget * self->period >= (double)(deadline - now) * self->budget) {
+			deadline = now + self->period;
+			atomic_store_explicit(&self->consumed, 0, memory_order_relaxed);
+			atomic_store_explicit(&self->replenish_deadline, deadline, memory_order_release);
+		}
+	}
+
+	return deadline > absolute_deadline ? deadline : absolute_deadline;
+}
+
+/**
+ * Charges execution time against the reservation. Each time the budget is exhausted, the server deadline is postponed
+ * by a period. If this pushes the server deadline past the sandbox's deadline, the sandbox's deadline is postponed to
+ * match. Safe to call from the SIGALRM handler
+ * @param self
+ * @param execution_duration cycles executed since the last charge
+ * @param absolute_deadline pointer to the deadline of the charged sandbox, updated in place
+ * @returns true if absolute_deadline was postponed
+ */
+static inline bool
+module_reservation_charge(struct module_reservation *self, uint64_t execution_duration, uint64_t *absolute_deadline)
+{
+	if (!module_reservation_is_enabled(self)) return false;
+
+	uint64_t consumed = atomic_fetch_add_explicit(&self->consumed, execution_duration, memory_order_relaxed)
+	                    + execution_duration;
+	uint64_t deadline = module_reservation_get_server_deadline(self, consumed);
+	if (deadline <= *absolute_deadline) return false;
+
+	*absolute_deadline = deadline;
+	return true;
+}
+
+/**
+ * Releases a request passed through module_reservation_get_deadline once it completes, errors, or is rejected. The
+ * server becomes idle when its last outstanding request is released
+ * @param self
+ */
+static inline void
+module_reservation_release(struct module_reservation *self)
+{
+	if (!module_reservation_is_enabled(self)) return;
+
+	/* Publish the charges of the released request to the listener that finds the server idle */
+	uint32_t outstanding = atomic_fetch_sub_explicit(&self->outstanding, 1, memory_order_release);
+	assert(outstanding > 0);
+	(void)outstanding;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "counter_shard.h"
+#include "runtime.h"
+#include "types.h"
+
+#define MODULE_SLO_WINDOW_PERIOD_US        1000000 /* The window slides by a second */
+#define MODULE_SLO_WINDOW_COUNT            10      /* over the last 10 seconds */
+#define MODULE_SLO_WINDOW_MIN_COMPLETIONS  16      /* Fewer completions in a window are too noisy to alert on */
+#define MODULE_SLO_MISS_PERMILLE_MAX       1000
+
+enum module_slo_outcome
+{
+	MODULE_SLO_ADMITTED = 0, /* Accepted by the listener */
+	MODULE_SLO_REJECTED,     /* Rejected by the listener, or shed by a worker after being admitted */
+	MODULE_SLO_ON_TIME,      /* Completed within the relative deadline, or without a deadline */
+	MODULE_SLO_LATE,         /* Completed after the relative deadline */
+	MODULE_SLO_ERRORED,
+	MODULE_SLO_OUTCOME_COUNT
+};
+
+extern const char *module_slo_outcome_labels[MODULE_SLO_OUTCOME_COUNT];
+
+struct module_slo_shard {
+	_Atomic int64_t outcomes[MODULE_SLO_OUTCOME_COUNT];
+} CACHE_ALIGNED;
+
+/*
+ * Request outcomes of a module and its deadline miss ratio over a sliding window
+ *
+ * Outcomes are sharded counters, so the listener and workers count them without sharing cache lines. The worker that
+ * completes the first sandbox of a module after the window period has elapsed claims the period, like the early drop
+ * sweep, and slides the window by comparing the totals to those of MODULE_SLO_WINDOW_COUNT periods ago. Periods
+ * without completions do not slide the window, so it spans at least MODULE_SLO_WINDOW_COUNT periods. When the miss
+ * ratio crosses the threshold of the module, the worker logs an event, and logs another once the ratio recovers.
+ *
+ * The window is only written while holding is_sliding, which orders each slide after the previous one. A worker that
+ * claims a period while another is still sliding skips its slide rather than waiting.
+ */
+struct module_slo {
+	struct module_slo_shard *shards;                  /* Indexed by counter_shard_idx */
+	uint32_t                 miss_threshold_permille; /* 0 disables events */
+	_Atomic uint32_t         miss_permille;           /* Over the window */
+	_Atomic uint64_t         window_last_slide;       /* cycles */
+	_Atomic bool             is_sliding;
+
+	/* Only accessed while holding is_sliding */
+	uint64_t window_completions[MODULE_SLO_WINDOW_COUNT]; /* Total completions at the end of each period */
+	uint64_t window_misses[MODULE_SLO_WINDOW_COUNT];
+	uint32_t window_head; /* Oldest period */
+	bool     is_missing;  /* The miss ratio is above the threshold */
+};
+
+void module_slo_initialize(struct module_slo *self, uint32_t miss_threshold_permille);
+void module_slo_deinitialize(struct module_slo *self);
+void module_slo_sum(struct module_slo *self, uint64_t totals[MODULE_SLO_OUTCOME_COUNT]);
+void module_slo_slide_window(struct module_slo *self, const char *module_name);
+
+/**
+ * Counts an outcome in the shard of the calling thread
+ * @param self
+ * @param outcome
+ */
+static inline void
+module_slo_record(struct module_slo *self, enum module_slo_outcome outcome)
+{
+	counter_shard_add(&self->shards[counter_shard_idx].outcomes[outcome], 1);
+}
+
+/**
+ * Counts a completed sandbox as on time or late, and slides the window once per period
+ * @param self
+ * @param module_name used in events
+ * @param response_time cycles from request arrival to response
+ * @param relative_deadline cycles. 0 if the request has no deadline
+ * @param now cycles
+ */
+static inline void
+module_slo_record_completion(struct module_slo *self, const char *module_name, uint64_t response_time,
+                             uint64_t relative_deadline, uint64_t now)
+{
+	bool is_late = relative_deadline > 0 && response_time > relative_deadline;
+	module_slo_record(self, is_late ? MODULE_SLO_LATE : MODULE_SLO_ON_TIME);
+
+	uint64_t last_slide = atomic_load_explicit(&self->window_last_slide, memory_order_relaxed);
+	if (now - last_slide < (uint64_t)MODULE_SLO_WINDOW_PERIOD_US * runtime_processor_speed_MHz) return;
+	if (!atomic_compare_exchange_strong(&self->window_last_slide, &last_slide, now)) return;
+
+	module_slo_slide_window(self, module_name);
+}
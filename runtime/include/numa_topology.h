@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Upper bound on the NUMA nodes the runtime distinguishes. Nodes beyond this are treated as node 0 */
+#define NUMA_TOPOLOGY_NODE_MAX 8
+
+int numa_topology_get_node_of_cpu(uint32_t cpu);
+int numa_topology_bind(void *addr, size_t length, int node);
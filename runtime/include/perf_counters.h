@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "likely.h"
+#include "types.h"
+
+/*
+ * Optional hardware performance counters, enabled with SLEDGE_PERF_COUNTERS. Each worker opens a perf_event_open
+ * group counting the events below for its own thread in user space. The group is read when a sandbox starts running
+ * and whenever it stops running, and the difference is accumulated into the sandbox, like running_duration.
+ *
+ * Each read is a read(2) of the group, which costs on the order of a microsecond, so this is meant for profiling
+ * rather than for production. If the kernel multiplexes the group with other events, counts are scaled by the fraction
+ * of time the group was scheduled. Events a worker could not count are reported as PERF_COUNTERS_UNAVAILABLE rather
+ * than as 0.
+ */
+enum perf_counters_event
+{
+	PERF_COUNTERS_CYCLES = 0,
+	PERF_COUNTERS_INSTRUCTIONS,
+	PERF_COUNTERS_LLC_MISSES,
+	PERF_COUNTERS_DTLB_MISSES,
+	PERF_COUNTERS_EVENT_COUNT
+};
+
+/* Reported for an event that a worker could not count */
+#define PERF_COUNTERS_UNAVAILABLE UINT64_MAX
+
+extern const char *perf_counters_event_labels[PERF_COUNTERS_EVENT_COUNT];
+
+extern bool perf_counters_enabled;
+
+/* Bitmask of the events each worker counts, indexed by worker_thread_idx. 0 if the group of the worker failed */
+extern _Atomic uint32_t *perf_counters_worker_events;
+
+/* Group of the calling worker. -1 if counters are disabled or could not be opened */
+extern __thread int perf_counters_group_file_descriptor;
+
+/* Position of each event in the group of the calling worker, or -1 if it is not supported */
+extern __thread int perf_counters_group_index[PERF_COUNTERS_EVENT_COUNT];
+
+/* Counts when the sandbox running on the calling worker started running */
+extern __thread uint64_t perf_counters_switch_in_counts[PERF_COUNTERS_EVENT_COUNT];
+
+/*
+ * Totals of the sandboxes of a module completed by a single worker. Each worker only writes its own entry, and readers
+ * sum the entries of all workers
+ */
+struct perf_counters_module_worker {
+	_Atomic uint64_t totals[PERF_COUNTERS_EVENT_COUNT];
+} CACHE_ALIGNED;
+
+void perf_counters_initialize(void);
+void perf_counters_initialize_worker(void);
+void perf_counters_module_initialize(struct perf_counters_module_worker **module_totals);
+void perf_counters_module_sum(struct perf_counters_module_worker *module_totals,
+                              uint64_t                            sums[PERF_COUNTERS_EVENT_COUNT]);
+
+/**
+ * Reads the counters of the calling worker, scaled up if the group was multiplexed
+ * @param counts indexed by enum perf_counters_event
+ */
+static inline void
+perf_counters_read(uint64_t counts[PERF_COUNTERS_EVENT_COUNT])
+{
+	struct {
+		uint64_t count;
+		uint64_t time_enabled; /* ns */
+		uint64_t time_running; /* ns */
+		uint64_t values[PERF_COUNTERS_EVENT_COUNT];
+	} group;
+
+	if (unlikely(read(perf_counters_group_file_descriptor, &group, sizeof(group)) < 0 || group.time_running == 0)) {
+		memset(counts, 0, PERF_COUNTERS_EVENT_COUNT * sizeof(uint64_t));
+		return;
+	}
+
+	bool is_multiplexed = group.time_running < group.time_enabled;
+	for (int i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++) {
+		counts[i] = perf_counters_group_index[i] >= 0 ? group.values[perf_counters_group_index[i]] : 0;
+		if (unlikely(is_multiplexed))
+			counts[i] = (uint64_t)((double)counts[i] * group.time_enabled / group.time_running);
+	}
+}
+
+/**
+ * Gets a count of a sandbox that ran on the calling worker
+ * @param counts of the sandbox
+ * @param event
+ * @returns the count, or PERF_COUNTERS_UNAVAILABLE if the calling worker could not count the event
+ */
+static inline uint64_t
+perf_counters_get(uint64_t counts[PERF_COUNTERS_EVENT_COUNT], enum perf_counters_event event)
+{
+	if (perf_counters_enabled
+	    && (perf_counters_group_file_descriptor < 0 || perf_counters_group_index[event] < 0))
+		return PERF_COUNTERS_UNAVAILABLE;
+
+	return counts[event];
+}
+
+/**
+ * Called when a sandbox starts running on the calling worker
+ */
+static inline void
+perf_counters_switch_in(void)
+{
+	if (likely(perf_counters_group_file_descriptor < 0)) return;
+
+	perf_counters_read(perf_counters_switch_in_counts);
+}
+
+/**
+ * Called when a sandbox stops running on the calling worker
+ * @param totals accumulated counts of the sandbox, indexed by enum perf_counters_event
+ */
+static inline void
+perf_counters_switch_out(uint64_t totals[PERF_COUNTERS_EVENT_COUNT])
+{
+	if (likely(perf_counters_group_file_descriptor < 0)) return;
+
+	uint64_t counts[PERF_COUNTERS_EVENT_COUNT];
+	perf_counters_read(counts);
+	for (int i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++) totals[i] += counts[i] - perf_counters_switch_in_counts[i];
+}
+
+/**
+ * Adds the counts of a completed sandbox to the totals of its module. Only the worker that completed the sandbox may
+ * call this
+ * @param module_totals per-worker totals of the module, or NULL if counters are disabled
+ * @param worker_idx index of the calling worker
+ * @param counts of the sandbox
+ */
+static inline void
+perf_counters_module_add(struct perf_counters_module_worker *module_totals, int worker_idx,
+                         uint64_t counts[PERF_COUNTERS_EVENT_COUNT])
+{
+	if (module_totals == NULL) return;
+
+	struct perf_counters_module_worker *worker = &module_totals[worker_idx];
+	for (int i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++) {
+		atomic_store_explicit(&worker->totals[i],
+		                      atomic_load_explicit(&worker->totals[i], memory_order_relaxed) + counts[i],
+		                      memory_order_relaxed);
+	}
+}
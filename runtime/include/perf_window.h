@@ -1,8 +1,9 @@
 #pragma once
 
+#include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
-#include "lock.h"
 #include "perf_window_t.h"
 #include "runtime.h"
 #include "worker_thread.h"
@@ -16,7 +17,6 @@ perf_window_initialize(struct perf_window *self)
 {
 	assert(self != NULL);
 
-	LOCK_INIT(&self->lock);
 	self->count = 0;
 	memset(&self->by_duration, 0, sizeof(struct execution_node) * PERF_WINDOW_BUFFER_SIZE);
 	memset(&self->by_termination, 0, sizeof(uint16_t) * PERF_WINDOW_BUFFER_SIZE);
@@ -33,7 +33,6 @@ perf_window_initialize(struct perf_window *self)
 static inline void
 perf_window_swap(struct perf_window *self, uint16_t first_by_duration_idx, uint16_t second_by_duration_idx)
 {
-	assert(LOCK_IS_LOCKED(&self->lock));
 	assert(self != NULL);
 	assert(first_by_duration_idx >= 0 && first_by_duration_idx < PERF_WINDOW_BUFFER_SIZE);
 	assert(second_by_duration_idx >= 0 && second_by_duration_idx < PERF_WINDOW_BUFFER_SIZE);
@@ -66,7 +65,7 @@ perf_window_swap(struct perf_window *self, uint16_t first_by_duration_idx, uint1
 
 /**
  * Adds a new value to the perf window
- * Not intended to be called directly!
+ * Not intended to be called directly! Must only be called by the worker that owns the perf window
  * @param self
  * @param value
  */
@@ -75,8 +74,6 @@ perf_window_add(struct perf_window *self, uint64_t value)
 {
 	assert(self != NULL);
 
-	if (unlikely(!LOCK_IS_LOCKED(&self->lock))) panic("lock not held when calling perf_window_add\n");
-
 	/* A successful invocation should run for a non-zero amount of time */
 	assert(value > 0);
 
@@ -2,8 +2,6 @@
 
 #include <stdint.h>
 
-#include "lock.h"
-
 /* Should be Power of 2! */
 #define PERF_WINDOW_BUFFER_SIZE 16
 
@@ -12,6 +10,8 @@
 #endif
 
 /*
+ * A perf window has a single writer, the worker thread that owns it, so it is not protected by a lock
+ *
  * The by_duration array sorts the last N executions by execution time
  * The by_termination array acts as a circular buffer that maps to indices in the by_duration array
  *
@@ -27,5 +27,4 @@ struct perf_window {
 	struct execution_node by_duration[PERF_WINDOW_BUFFER_SIZE];
 	uint16_t              by_termination[PERF_WINDOW_BUFFER_SIZE];
 	uint64_t              count;
-	lock_t                lock;
 };
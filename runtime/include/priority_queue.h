@@ -1,6 +1,8 @@
 #ifndef PRIORITY_QUEUE_H
 #define PRIORITY_QUEUE_H
 
+#include <limits.h>
+
 #include "lock.h"
 #include "listener_thread.h"
 #include "panic.h"
@@ -18,6 +20,14 @@
  */
 typedef uint64_t (*priority_queue_get_priority_fn_t)(void *element);
 
+/**
+ * Selects elements to remove from the priority queue
+ * @param element
+ * @param argument caller-provided context
+ * @returns true if the element should be removed
+ */
+typedef bool (*priority_queue_predicate_fn_t)(void *element, void *argument);
+
 /* We assume that priority is expressed in terms of a 64 bit unsigned integral */
 struct priority_queue {
 	priority_queue_get_priority_fn_t get_priority_fn;
@@ -402,6 +412,108 @@ priority_queue_delete(struct priority_queue *self, void *value)
 	return rc;
 }
 
+/**
+ * Dequeues up to max_count elements in priority order. The first element must be earlier than target_deadline.
+ * Subsequent elements must additionally fall within batch_window of the priority of the first element.
+ * @param self - the priority queue we want to dequeue from
+ * @param dequeued_elements - buffer to store the dequeued elements
+ * @param max_count - the maximum number of elements to dequeue
+ * @param target_deadline - the deadline that elements must be earlier than in order to dequeue
+ * @param batch_window - the maximum distance in priority from the first dequeued element
+ * @returns the number of dequeued elements
+ */
+static inline int
+priority_queue_dequeue_batch_if_earlier_nolock(struct priority_queue *self, void **dequeued_elements, int max_count,
+                                               uint64_t target_deadline, uint64_t batch_window)
+{
+	assert(self != NULL);
+	assert(dequeued_elements != NULL);
+	assert(max_count > 0);
+	assert(!self->use_lock || LOCK_IS_LOCKED(&self->lock));
+
+	int dequeued_count = 0;
+	if (priority_queue_dequeue_if_earlier_nolock(self, &dequeued_elements[0], target_deadline) < 0) goto done;
+	dequeued_count++;
+
+	uint64_t window_end = self->get_priority_fn(dequeued_elements[0]) + batch_window;
+	if (window_end < target_deadline) target_deadline = window_end;
+
+	while (dequeued_count < max_count
+	       && priority_queue_dequeue_if_earlier_nolock(self, &dequeued_elements[dequeued_count], target_deadline)
+	            == 0)
+		dequeued_count++;
+
+done:
+	return dequeued_count;
+}
+
+/**
+ * Removes elements matching a predicate, up to the capacity of the removed buffer, and then rebuilds the heap
+ * @param self - the priority queue we want to remove from
+ * @param predicate - function returning true if an element should be removed
+ * @param argument - passed through to predicate
+ * @param removed - buffer to store removed elements
+ * @param removed_capacity - the size of the removed buffer
+ * @returns the number of removed elements
+ */
+static inline int
+priority_queue_remove_if_nolock(struct priority_queue *self, priority_queue_predicate_fn_t predicate, void *argument,
+                                void **removed, int removed_capacity)
+{
+	assert(self != NULL);
+	assert(predicate != NULL);
+	assert(removed != NULL);
+	assert(!listener_thread_is_running());
+	assert(!self->use_lock || LOCK_IS_LOCKED(&self->lock));
+
+	int removed_count = 0;
+	int kept_count    = 0;
+
+	/* Compact the kept elements toward the front of the array */
+	for (int i = 1; i <= self->size; i++) {
+		if (removed_count < removed_capacity && predicate(self->items[i], argument)) {
+			removed[removed_count++] = self->items[i];
+		} else {
+			self->items[++kept_count] = self->items[i];
+		}
+	}
+
+	if (removed_count == 0) return 0;
+
+	for (int i = kept_count + 1; i <= self->size; i++) self->items[i] = NULL;
+	self->size = kept_count;
+
+	/* Rebuild the heap bottom-up */
+	for (int i = self->size / 2; i >= 1; i--) priority_queue_percolate_down(self, i);
+	priority_queue_update_highest_priority(self, priority_queue_is_empty(self)
+	                                               ? ULONG_MAX
+	                                               : self->get_priority_fn(self->items[1]));
+
+	return removed_count;
+}
+
+/**
+ * Removes elements matching a predicate, up to the capacity of the removed buffer, and then rebuilds the heap
+ * @param self - the priority queue we want to remove from
+ * @param predicate - function returning true if an element should be removed
+ * @param argument - passed through to predicate
+ * @param removed - buffer to store removed elements
+ * @param removed_capacity - the size of the removed buffer
+ * @returns the number of removed elements
+ */
+static inline int
+priority_queue_remove_if(struct priority_queue *self, priority_queue_predicate_fn_t predicate, void *argument,
+                         void **removed, int removed_capacity)
+{
+	int removed_count;
+
+	LOCK_LOCK(&self->lock);
+	removed_count = priority_queue_remove_if_nolock(self, predicate, argument, removed, removed_capacity);
+	LOCK_UNLOCK(&self->lock);
+
+	return removed_count;
+}
+
 /**
  * @param self - the priority queue we want to add to
  * @param dequeued_element a pointer to set to the dequeued element
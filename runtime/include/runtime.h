@@ -8,25 +8,24 @@
 #include "likely.h"
 #include "types.h"
 
-#ifndef NCORES
-#warning "NCORES not defined in Makefile. Defaulting to 2"
-#define NCORES 2
-#endif
-
-#if NCORES == 1
-#error "RUNTIME MINIMUM REQUIREMENT IS 2 CORES"
-#endif
-
+#define RUNTIME_CALIBRATION_INTERVAL_NS   100000000 /* 100ms */
+#define RUNTIME_CALIBRATION_SAMPLE_COUNT  16
 #define RUNTIME_EXPECTED_EXECUTION_US_MAX 3600000000
 #define RUNTIME_HTTP_REQUEST_SIZE_MAX     100000000 /* 100 MB */
 #define RUNTIME_HTTP_RESPONSE_SIZE_MAX    100000000 /* 100 MB */
 #define RUNTIME_LOG_FILE                  "sledge.log"
 #define RUNTIME_MAX_EPOLL_EVENTS          128
 #define RUNTIME_MAX_SANDBOX_REQUEST_COUNT (1 << 19)
-#define RUNTIME_MAX_WORKER_COUNT          32 /* Static buffer size for per-worker globals */
 #define RUNTIME_READ_WRITE_VECTOR_LENGTH  16
 #define RUNTIME_RELATIVE_DEADLINE_US_MAX  3600000000 /* One Hour. Fits in uint32_t */
-#define RUNTIME_WORKER_THREAD_CORE_COUNT  (NCORES > 1 ? NCORES - 1 : NCORES)
+
+/*
+ * The active deadline of the sandbox running on a worker. Each worker writes its own entry on every context switch and
+ * the SIGALRM triage reads all of them, so entries are padded to a cache line to avoid false sharing
+ */
+struct runtime_worker_deadline {
+	uint64_t deadline;
+} CACHE_ALIGNED;
 
 enum RUNTIME_SIGALRM_HANDLER
 {
@@ -34,17 +33,25 @@ enum RUNTIME_SIGALRM_HANDLER
 	RUNTIME_SIGALRM_HANDLER_TRIAGED   = 1
 };
 
-extern bool                         runtime_preemption_enabled;
-extern uint32_t                     runtime_processor_speed_MHz;
-extern uint32_t                     runtime_quantum_us;
-extern FILE *                       runtime_sandbox_perf_log;
-extern enum RUNTIME_SIGALRM_HANDLER runtime_sigalrm_handler;
-extern pthread_t                    runtime_worker_threads[];
-extern uint32_t                     runtime_worker_threads_count;
-extern int                          runtime_worker_threads_argument[RUNTIME_WORKER_THREAD_CORE_COUNT];
-extern uint64_t                     runtime_worker_threads_deadline[RUNTIME_WORKER_THREAD_CORE_COUNT];
+extern bool                            runtime_early_drop_enabled;
+extern bool                            runtime_numa_enabled;
+extern uint32_t                        runtime_early_drop_sweep_period_us;
+extern bool                            runtime_deadline_header_enabled;
+extern bool                            runtime_preemption_enabled;
+extern uint32_t                        runtime_processor_speed_MHz;
+extern uint32_t                        runtime_quantum_us;
+extern enum RUNTIME_SIGALRM_HANDLER    runtime_sigalrm_handler;
+extern pthread_t *                     runtime_worker_threads;
+extern uint32_t                        runtime_worker_threads_count;
+extern bool                            runtime_worker_idle_sleep_enabled;
+extern uint32_t                        runtime_worker_idle_spin_us;
+extern int *                           runtime_worker_threads_argument;
+extern uint32_t *                      runtime_worker_threads_core;
+extern struct runtime_worker_deadline *runtime_worker_threads_deadline;
 
-extern void runtime_initialize(void);
+extern void *runtime_allocate_cache_aligned(size_t element_count, size_t element_size);
+extern void *runtime_allocate_per_worker(size_t element_size);
+extern void  runtime_initialize(void);
 extern void runtime_set_pthread_prio(pthread_t thread, unsigned int nice);
 extern void runtime_set_resource_limits_to_max(void);
 
@@ -6,6 +6,7 @@
 
 #include "client_socket.h"
 #include "panic.h"
+#include "sandbox_perf_log.h"
 #include "sandbox_request.h"
 
 /***************************
@@ -91,6 +92,55 @@ sandbox_get_priority(void *element)
 	return sandbox->absolute_deadline;
 };
 
+/**
+ * Estimates how much longer a sandbox needs to run to complete
+ * Clamps to 0 if the sandbox has already run longer than its execution estimate
+ * @param sandbox
+ * @returns remaining execution in cycles
+ */
+static inline uint64_t
+sandbox_get_remaining_execution(struct sandbox *sandbox)
+{
+	uint64_t estimated_execution = sandbox->estimated_execution;
+	if (sandbox->running_duration >= estimated_execution) return 0;
+	return estimated_execution - sandbox->running_duration;
+}
+
+/**
+ * Adds the cycles run since the sandbox was switched in or last refreshed to its running_duration. Called when the
+ * sandbox stops running, and while it runs before its LLF or SRPT priority is compared against other sandboxes
+ * @param sandbox a running sandbox
+ * @param now
+ */
+static inline void
+sandbox_refresh_running_duration(struct sandbox *sandbox, uint64_t now)
+{
+	sandbox->running_duration += now - sandbox->running_refresh_timestamp;
+	sandbox->running_refresh_timestamp = now;
+}
+
+/**
+ * Least Laxity First priority. Laxity is absolute_deadline - now - remaining execution, but now is common to all
+ * sandboxes at the time of comparison, so it is dropped
+ */
+static inline uint64_t
+sandbox_get_priority_llf(void *element)
+{
+	struct sandbox *sandbox   = (struct sandbox *)element;
+	uint64_t        remaining = sandbox_get_remaining_execution(sandbox);
+	return sandbox->absolute_deadline > remaining ? sandbox->absolute_deadline - remaining : 0;
+};
+
+/**
+ * Shortest Remaining Processing Time priority
+ */
+static inline uint64_t
+sandbox_get_priority_srpt(void *element)
+{
+	struct sandbox *sandbox = (struct sandbox *)element;
+	return sandbox_get_remaining_execution(sandbox);
+};
+
 /**
  * Maps a sandbox fd to an underlying host fd
  * Returns error condition if the file_descriptor to set does not contain sandbox preopen magic
@@ -145,32 +195,14 @@ sandbox_open_http(struct sandbox *sandbox)
 }
 
 /**
- * Prints key performance metrics for a sandbox to runtime_sandbox_perf_log
- * This is defined by an environment variable
- * @param sandbox
+ * Logs key performance metrics for a sandbox to the sandbox perf log
+ * @param sandbox - the sandbox to log
  */
 static inline void
 sandbox_print_perf(struct sandbox *sandbox)
 {
 	/* If the log was not defined by an environment variable, early out */
-	if (runtime_sandbox_perf_log == NULL) return;
-
-	uint32_t total_time_us = sandbox->total_time / runtime_processor_speed_MHz;
-	uint32_t queued_us     = (sandbox->allocation_timestamp - sandbox->request_arrival_timestamp)
-	                     / runtime_processor_speed_MHz;
-	uint32_t initializing_us = sandbox->initializing_duration / runtime_processor_speed_MHz;
-	uint32_t runnable_us     = sandbox->runnable_duration / runtime_processor_speed_MHz;
-	uint32_t running_us      = sandbox->running_duration / runtime_processor_speed_MHz;
-	uint32_t blocked_us      = sandbox->blocked_duration / runtime_processor_speed_MHz;
-	uint32_t returned_us     = sandbox->returned_duration / runtime_processor_speed_MHz;
-
-	/*
-	 * Assumption: A sandbox is never able to free pages. If linear memory management
-	 * becomes more intelligent, then peak linear memory size needs to be tracked
-	 * seperately from current linear memory size.
-	 */
-	fprintf(runtime_sandbox_perf_log, "%lu,%s():%d,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", sandbox->id,
-	        sandbox->module->name, sandbox->module->port, sandbox_state_stringify(sandbox->state),
-	        sandbox->module->relative_deadline_us, total_time_us, queued_us, initializing_us, runnable_us,
-	        running_us, blocked_us, returned_us, sandbox->linear_memory_size);
+	if (!sandbox_perf_log_is_enabled()) return;
+
+	sandbox_perf_log_append(sandbox);
 }
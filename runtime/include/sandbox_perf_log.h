@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arch/getcycles.h"
+#include "runtime.h"
+#include "sandbox_perf_log_format.h"
+#include "sandbox_types.h"
+#include "types.h"
+#include "worker_thread.h"
+
+/* Records per worker ring. Must be a power of two */
+#define SANDBOX_PERF_LOG_RING_CAPACITY 4096
+
+/* How long the writer sleeps when all rings are empty */
+#define SANDBOX_PERF_LOG_WRITER_PERIOD_US 10000
+
+/*
+ * Each worker appends fixed-size binary records to its own single-producer single-consumer ring, and a background
+ * writer thread drains the rings to the log file in batches. Workers never block on the writer: when a ring is full,
+ * the record is dropped and counted. tools/perflog2csv converts a log to CSV.
+ *
+ * The producer index and the consumer index are on separate cache lines, so the worker and the writer only share a line
+ * when the writer observes new records.
+ */
+struct sandbox_perf_log_ring {
+	/* Written by the worker */
+	_Atomic uint64_t head;
+	uint64_t         dropped;
+	uint64_t         cycles; /* Spent appending records, to measure the overhead of logging */
+
+	/* Written by the writer */
+	_Atomic uint64_t tail CACHE_ALIGNED;
+
+	struct sandbox_perf_log_record records[SANDBOX_PERF_LOG_RING_CAPACITY] CACHE_ALIGNED;
+};
+
+extern struct sandbox_perf_log_ring *sandbox_perf_log_rings;
+
+void sandbox_perf_log_initialize(char *path);
+void sandbox_perf_log_stop(void);
+
+static inline bool
+sandbox_perf_log_is_enabled(void)
+{
+	return sandbox_perf_log_rings != NULL;
+}
+
+/**
+ * Appends a record for a sandbox that reached a terminal state to the ring of the calling worker
+ * @param sandbox
+ */
+static inline void
+sandbox_perf_log_append(struct sandbox *sandbox)
+{
+	uint64_t                      start = __getcycles();
+	struct sandbox_perf_log_ring *ring  = &sandbox_perf_log_rings[worker_thread_idx];
+
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	if (unlikely(head - tail == SANDBOX_PERF_LOG_RING_CAPACITY)) {
+		ring->dropped++;
+		return;
+	}
+
+	struct sandbox_perf_log_record *record = &ring->records[head & (SANDBOX_PERF_LOG_RING_CAPACITY - 1)];
+
+	record->id = sandbox->id;
+	memcpy(record->module_name, sandbox->module->name, SANDBOX_PERF_LOG_NAME_LENGTH);
+	record->module_port          = sandbox->module->port;
+	record->state                = sandbox->state;
+	record->relative_deadline_us = sandbox->module->relative_deadline_us;
+	record->total_time_us        = sandbox->total_time / runtime_processor_speed_MHz;
+	record->queued_us            = (sandbox->allocation_timestamp - sandbox->request_arrival_timestamp)
+	                    / runtime_processor_speed_MHz;
+	record->initializing_us    = sandbox->initializing_duration / runtime_processor_speed_MHz;
+	record->runnable_us        = sandbox->runnable_duration / runtime_processor_speed_MHz;
+	record->running_us         = sandbox->running_duration / runtime_processor_speed_MHz;
+	record->blocked_us         = sandbox->blocked_duration / runtime_processor_speed_MHz;
+	record->returned_us        = sandbox->returned_duration / runtime_processor_speed_MHz;
+	record->linear_memory_size = sandbox->linear_memory_size;
+	record->worker_idx         = worker_thread_idx;
+	record->cycles             = perf_counters_get(sandbox->perf_counters, PERF_COUNTERS_CYCLES);
+	record->instructions       = perf_counters_get(sandbox->perf_counters, PERF_COUNTERS_INSTRUCTIONS);
+	record->llc_misses         = perf_counters_get(sandbox->perf_counters, PERF_COUNTERS_LLC_MISSES);
+	record->dtlb_misses        = perf_counters_get(sandbox->perf_counters, PERF_COUNTERS_DTLB_MISSES);
+
+	/* Publish the record to the writer */
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+	ring->cycles += __getcycles() - start;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * On-disk format of the binary sandbox performance log written when SLEDGE_SANDBOX_PERF_LOG is set. This header only
+ * depends on stdint.h, so that tools/perflog2csv can decode logs without the rest of the runtime.
+ *
+ * A log is a sandbox_perf_log_header, followed by state_count state labels of SANDBOX_PERF_LOG_LABEL_LENGTH bytes
+ * each, followed by records of record_size bytes until the end of the file. Records of different workers are
+ * interleaved in batches, so they are not ordered by completion time. Integers are in the byte order of the host.
+ */
+
+#define SANDBOX_PERF_LOG_MAGIC        "SLEDGEPL"
+#define SANDBOX_PERF_LOG_VERSION      3
+#define SANDBOX_PERF_LOG_LABEL_LENGTH 32
+#define SANDBOX_PERF_LOG_NAME_LENGTH  32 /* Matches MODULE_MAX_NAME_LENGTH */
+
+/* Hardware counter value of an event the worker could not count. Matches PERF_COUNTERS_UNAVAILABLE */
+#define SANDBOX_PERF_LOG_COUNTER_UNAVAILABLE UINT64_MAX
+
+struct sandbox_perf_log_header {
+	char     magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t state_count;
+	uint32_t label_length;
+};
+
+struct sandbox_perf_log_record {
+	uint64_t id;
+	char     module_name[SANDBOX_PERF_LOG_NAME_LENGTH];
+	uint32_t module_port;
+	uint32_t state; /* Index into the state labels */
+	uint32_t relative_deadline_us;
+	uint32_t total_time_us;
+	uint32_t queued_us;
+	uint32_t initializing_us;
+	uint32_t runnable_us;
+	uint32_t running_us;
+	uint32_t blocked_us;
+	uint32_t returned_us;
+	uint32_t linear_memory_size; /* bytes */
+	uint32_t worker_idx;
+
+	/*
+	 * Hardware events counted while running. 0 unless SLEDGE_PERF_COUNTERS is set, and
+	 * SANDBOX_PERF_LOG_COUNTER_UNAVAILABLE if the worker could not count the event
+	 */
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t llc_misses;
+	uint64_t dtlb_misses;
+};
@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <sys/socket.h>
 
+#include "admissions_control.h"
+#include "client_socket.h"
 #include "debuglog.h"
 #include "deque.h"
 #include "http_total.h"
@@ -20,19 +22,63 @@ struct sandbox_request {
 	int             socket_descriptor;
 	struct sockaddr socket_address;
 	uint64_t        request_arrival_timestamp; /* cycles */
-	uint64_t        absolute_deadline;         /* cycles */
+	uint64_t        relative_deadline;         /* cycles. The module's, or tighter if overridden by the client */
+	uint64_t        absolute_deadline;         /* cycles. Scheduling key, postponed by a module reservation */
+	uint64_t        estimated_execution;       /* cycles. Estimate for the size of this request when known */
 
 	/*
 	 * Unitless estimate of the instantaneous fraction of system capacity required to run the request
 	 * Calculated by estimated execution time (cycles) * runtime_admissions_granularity / relative deadline (cycles)
 	 */
 	uint64_t admissions_estimate;
+
+	/* Set when the rejection of the request is deferred out of the SIGALRM handler */
+	struct sandbox_request *next_rejected;
+	int                     rejection_status_code;
 };
 
 DEQUE_PROTOTYPE(sandbox, struct sandbox_request *)
 
-/* Count of the total number of requests we've ever allocated. Never decrements as it is used to generate IDs */
-extern _Atomic uint32_t sandbox_request_count;
+static inline uint64_t
+sandbox_request_get_priority_fn(void *element)
+{
+	struct sandbox_request *sandbox_request = (struct sandbox_request *)element;
+	return sandbox_request->absolute_deadline;
+};
+
+/**
+ * Least Laxity First priority. A request has not yet run, so its remaining execution is the full estimate
+ */
+static inline uint64_t
+sandbox_request_get_priority_llf_fn(void *element)
+{
+	struct sandbox_request *sandbox_request = (struct sandbox_request *)element;
+	uint64_t                remaining       = sandbox_request->estimated_execution;
+	return sandbox_request->absolute_deadline > remaining ? sandbox_request->absolute_deadline - remaining : 0;
+};
+
+/**
+ * Shortest Remaining Processing Time priority
+ */
+static inline uint64_t
+sandbox_request_get_priority_srpt_fn(void *element)
+{
+	struct sandbox_request *sandbox_request = (struct sandbox_request *)element;
+	return sandbox_request->estimated_execution;
+};
+
+/*
+ * IDs are reserved from a global count in ranges of SANDBOX_REQUEST_ID_RANGE, and each listener thread hands out the
+ * IDs of its range without touching shared state. IDs are unique, but only ordered by arrival within a listener
+ */
+#define SANDBOX_REQUEST_ID_RANGE 1024
+
+/* Count of the IDs reserved by all listeners. Never decrements as it is used to generate IDs */
+extern _Atomic uint64_t sandbox_request_count;
+
+/* The unused part of the range of the calling thread */
+extern __thread uint64_t sandbox_request_id_next;
+extern __thread uint64_t sandbox_request_id_end;
 
 static inline void
 sandbox_request_count_initialize()
@@ -40,10 +86,17 @@ sandbox_request_count_initialize()
 	atomic_init(&sandbox_request_count, 0);
 }
 
-static inline uint32_t
-sandbox_request_count_postfix_increment()
+/**
+ * @returns a new sandbox request ID from the range of the calling thread, reserving a new range when it runs out
+ */
+static inline uint64_t
+sandbox_request_allocate_id()
 {
-	return atomic_fetch_add(&sandbox_request_count, 1);
+	if (unlikely(sandbox_request_id_next == sandbox_request_id_end)) {
+		sandbox_request_id_next = atomic_fetch_add(&sandbox_request_count, SANDBOX_REQUEST_ID_RANGE);
+		sandbox_request_id_end  = sandbox_request_id_next + SANDBOX_REQUEST_ID_RANGE;
+	}
+	return sandbox_request_id_next++;
 }
 
 static inline void
@@ -62,25 +115,32 @@ sandbox_request_log_allocation(struct sandbox_request *sandbox_request)
  * @param socket_descriptor
  * @param socket_address
  * @param request_arrival_timestamp the timestamp of when we receives the request from the network (in cycles)
+ * @param relative_deadline the relative deadline of the request in cycles
+ * @param admissions_estimate the admissions estimate of the request
+ * @param estimated_execution the execution estimate of the request in cycles
  * @return the new sandbox request
  */
 static inline struct sandbox_request *
 sandbox_request_allocate(struct module *module, char *arguments, int socket_descriptor,
                          const struct sockaddr *socket_address, uint64_t request_arrival_timestamp,
-                         uint64_t admissions_estimate)
+                         uint64_t relative_deadline, uint64_t admissions_estimate, uint64_t estimated_execution)
 {
 	struct sandbox_request *sandbox_request = (struct sandbox_request *)malloc(sizeof(struct sandbox_request));
 	assert(sandbox_request);
 
-	/* Sets the ID to the value before the increment */
-	sandbox_request->id = sandbox_request_count_postfix_increment();
+	sandbox_request->id = sandbox_request_allocate_id();
 
 	sandbox_request->module            = module;
 	sandbox_request->arguments         = arguments;
 	sandbox_request->socket_descriptor = socket_descriptor;
 	memcpy(&sandbox_request->socket_address, socket_address, sizeof(struct sockaddr));
 	sandbox_request->request_arrival_timestamp = request_arrival_timestamp;
-	sandbox_request->absolute_deadline         = request_arrival_timestamp + module->relative_deadline;
+
+	/* Modules with a bandwidth reservation may have their deadline postponed to that of their server */
+	sandbox_request->relative_deadline = relative_deadline;
+	uint64_t absolute_deadline         = request_arrival_timestamp + relative_deadline;
+	sandbox_request->absolute_deadline = module_reservation_get_deadline(&module->reservation,
+	                                                                     request_arrival_timestamp, absolute_deadline);
 
 	/*
 	 * Admissions Control State
@@ -89,7 +149,49 @@ sandbox_request_allocate(struct module *module, char *arguments, int socket_desc
 	assert(admissions_estimate != 0);
 	sandbox_request->admissions_estimate = admissions_estimate;
 
+	/* Snapshot the estimate so a request's priority does not change while it is in a priority queue */
+	sandbox_request->estimated_execution = estimated_execution;
+
 	sandbox_request_log_allocation(sandbox_request);
 
 	return sandbox_request;
 }
+
+/**
+ * Checks if a request can still complete by its deadline given its execution estimate
+ * Requests without a relative deadline are always considered feasible. The deadline is that of the client, not the
+ * scheduling deadline, which a module reservation may have postponed past it
+ * @param sandbox_request
+ * @param now timestamp in cycles
+ * @returns 0 if feasible, 504 if the deadline has passed, or 503 if too little time remains to complete
+ */
+static inline int
+sandbox_request_check_feasibility(struct sandbox_request *sandbox_request, uint64_t now)
+{
+	if (sandbox_request->relative_deadline == 0) return 0;
+
+	uint64_t deadline = sandbox_request->request_arrival_timestamp + sandbox_request->relative_deadline;
+	if (now >= deadline) return 504;
+	if (now + sandbox_request->estimated_execution > deadline) return 503;
+	return 0;
+}
+
+/**
+ * Rejects a sandbox request without allocating a sandbox, releasing its admissions estimate, reservation, and
+ * concurrency slot and freeing it
+ * @param sandbox_request
+ * @param status_code HTTP status code sent to the client
+ */
+static inline void
+sandbox_request_reject(struct sandbox_request *sandbox_request, int status_code)
+{
+	assert(sandbox_request != NULL);
+
+	module_slo_record(&sandbox_request->module->slo, MODULE_SLO_REJECTED);
+	client_socket_send(sandbox_request->socket_descriptor, status_code);
+	client_socket_close(sandbox_request->socket_descriptor, &sandbox_request->socket_address);
+	admissions_control_subtract(sandbox_request->admissions_estimate);
+	module_reservation_release(&sandbox_request->module->reservation);
+	module_concurrency_release(&sandbox_request->module->concurrency);
+	free(sandbox_request);
+}
@@ -5,6 +5,8 @@
 
 #include "arch/getcycles.h"
 #include "local_runqueue.h"
+#include "sandbox_functions.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
 #include "sandbox_state.h"
 
@@ -28,8 +30,11 @@ sandbox_set_as_blocked(struct sandbox *sandbox, sandbox_state_t last_state)
 
 	switch (last_state) {
 	case SANDBOX_RUNNING: {
-		sandbox->running_duration += duration_of_last_state;
+		sandbox_refresh_running_duration(sandbox, now);
+		perf_counters_switch_out(sandbox->perf_counters);
 		local_runqueue_delete(sandbox);
+		module_reservation_charge(&sandbox->module->reservation, duration_of_last_state,
+		                          &sandbox->absolute_deadline);
 		break;
 	}
 	default: {
@@ -38,6 +43,7 @@ sandbox_set_as_blocked(struct sandbox *sandbox, sandbox_state_t last_state)
 	}
 	}
 
+	sandbox_trace_transition(sandbox, last_state, now);
 	sandbox->last_state_change_timestamp = now;
 	sandbox->state                       = SANDBOX_BLOCKED;
 
@@ -8,8 +8,9 @@
 #include "local_completion_queue.h"
 #include "sandbox_functions.h"
 #include "sandbox_state.h"
-#include "sandbox_summarize_page_allocations.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
+#include "worker_thread.h"
 
 /**
  * Transitions a sandbox from the SANDBOX_RETURNED state to the SANDBOX_COMPLETE state.
@@ -40,8 +41,10 @@ sandbox_set_as_complete(struct sandbox *sandbox, sandbox_state_t last_state)
 	}
 	}
 
+	sandbox_trace_transition(sandbox, last_state, now);
 	sandbox->last_state_change_timestamp = now;
 	sandbox->state                       = SANDBOX_COMPLETE;
+	sandbox_trace_record(sandbox, SANDBOX_COMPLETE, now, now);
 
 	/* State Change Bookkeeping */
 	sandbox_state_log_transition(sandbox->id, last_state, SANDBOX_COMPLETE);
@@ -49,12 +52,29 @@ sandbox_set_as_complete(struct sandbox *sandbox, sandbox_state_t last_state)
 	runtime_sandbox_total_decrement(last_state);
 
 	/* Admissions Control Post Processing */
-	admissions_info_update(&sandbox->module->admissions_info, sandbox->running_duration);
+	admissions_info_update(&sandbox->module->admissions_info, sandbox->running_duration,
+	                       sandbox->http_request.body_length + sandbox->http_request.body_read_length);
 	admissions_control_subtract(sandbox->admissions_estimate);
+	module_reservation_release(&sandbox->module->reservation);
+	module_concurrency_release(&sandbox->module->concurrency);
+	module_slo_record_completion(&sandbox->module->slo, sandbox->module->name,
+	                             sandbox->response_timestamp - sandbox->request_arrival_timestamp,
+	                             sandbox->relative_deadline, now);
+	admissions_control_record_completion(sandbox->allocation_timestamp - sandbox->request_arrival_timestamp,
+	                                     sandbox->relative_deadline);
 
 	/* Terminal State Logging */
+	uint64_t latencies[MODULE_LATENCY_METRIC_COUNT] = {
+		[MODULE_LATENCY_END_TO_END] = sandbox->total_time,
+		[MODULE_LATENCY_QUEUED]     = sandbox->allocation_timestamp - sandbox->request_arrival_timestamp,
+		[MODULE_LATENCY_RUNNING]    = sandbox->running_duration,
+		[MODULE_LATENCY_BLOCKED]    = sandbox->blocked_duration,
+	};
+	module_latency_record(&sandbox->module->latency, worker_thread_idx, latencies);
+	module_memory_profile_record(&sandbox->module->memory_profile, worker_thread_idx, sandbox->linear_memory_size,
+	                             sandbox->linear_memory_growth_count, sandbox->linear_memory_growth_duration);
+	perf_counters_module_add(sandbox->module->perf_counters, worker_thread_idx, sandbox->perf_counters);
 	sandbox_print_perf(sandbox);
-	sandbox_summarize_page_allocations(sandbox);
 
 	/* Do not touch sandbox state after adding to completion queue to avoid use-after-free bugs */
 	local_completion_queue_add(sandbox);
@@ -8,7 +8,7 @@
 #include "local_runqueue.h"
 #include "sandbox_state.h"
 #include "sandbox_functions.h"
-#include "sandbox_summarize_page_allocations.h"
+#include "sandbox_trace.h"
 #include "panic.h"
 
 /**
@@ -39,8 +39,15 @@ sandbox_set_as_error(struct sandbox *sandbox, sandbox_state_t last_state)
 		sandbox->initializing_duration += duration_of_last_state;
 		break;
 	case SANDBOX_RUNNING: {
-		sandbox->running_duration += duration_of_last_state;
+		sandbox_refresh_running_duration(sandbox, now);
+		perf_counters_switch_out(sandbox->perf_counters);
 		local_runqueue_delete(sandbox);
+		module_reservation_charge(&sandbox->module->reservation, duration_of_last_state,
+		                          &sandbox->absolute_deadline);
+		/* Degenerate sandboxes never held a slot. Their request is rejected by the caller of sandbox_allocate */
+		module_reservation_release(&sandbox->module->reservation);
+		module_concurrency_release(&sandbox->module->concurrency);
+		module_slo_record(&sandbox->module->slo, MODULE_SLO_ERRORED);
 		break;
 	}
 	default: {
@@ -49,10 +56,12 @@ sandbox_set_as_error(struct sandbox *sandbox, sandbox_state_t last_state)
 	}
 	}
 
+	sandbox_trace_transition(sandbox, last_state, now);
+	sandbox_trace_record(sandbox, SANDBOX_ERROR, now, now);
+
 	uint64_t sandbox_id = sandbox->id;
 	sandbox->state      = SANDBOX_ERROR;
 	sandbox_print_perf(sandbox);
-	sandbox_summarize_page_allocations(sandbox);
 	sandbox_free_linear_memory(sandbox);
 	admissions_control_subtract(sandbox->admissions_estimate);
 	/* Do not touch sandbox after adding to completion queue to avoid use-after-free bugs */
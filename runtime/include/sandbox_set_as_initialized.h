@@ -8,6 +8,7 @@
 #include "current_sandbox.h"
 #include "ps_list.h"
 #include "sandbox_request.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
 
 /**
@@ -28,6 +29,7 @@ sandbox_set_as_initialized(struct sandbox *sandbox, struct sandbox_request *sand
 
 	sandbox->id                  = sandbox_request->id;
 	sandbox->admissions_estimate = sandbox_request->admissions_estimate;
+	sandbox->estimated_execution = sandbox_request->estimated_execution;
 
 	sandbox->request_arrival_timestamp = sandbox_request->request_arrival_timestamp;
 	sandbox->allocation_timestamp      = allocation_timestamp;
@@ -45,11 +47,13 @@ sandbox_set_as_initialized(struct sandbox *sandbox, struct sandbox_request *sand
 	ps_list_init_d(sandbox);
 
 	/* Copy the socket descriptor, address, and arguments of the client invocation */
+	sandbox->relative_deadline        = sandbox_request->relative_deadline;
 	sandbox->absolute_deadline        = sandbox_request->absolute_deadline;
 	sandbox->arguments                = (void *)sandbox_request->arguments;
 	sandbox->client_socket_descriptor = sandbox_request->socket_descriptor;
 	memcpy(&sandbox->client_address, &sandbox_request->socket_address, sizeof(struct sockaddr));
 
+	sandbox_trace_record(sandbox, SANDBOX_TRACE_QUEUED, sandbox->request_arrival_timestamp, allocation_timestamp);
 	sandbox->last_state_change_timestamp = allocation_timestamp; /* We use arg to include alloc */
 	sandbox->state                       = SANDBOX_INITIALIZED;
 
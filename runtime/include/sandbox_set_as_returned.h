@@ -8,6 +8,7 @@
 #include "panic.h"
 #include "sandbox_functions.h"
 #include "sandbox_state.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
 
 /**
@@ -33,8 +34,11 @@ sandbox_set_as_returned(struct sandbox *sandbox, sandbox_state_t last_state)
 	case SANDBOX_RUNNING: {
 		sandbox->response_timestamp = now;
 		sandbox->total_time         = now - sandbox->request_arrival_timestamp;
-		sandbox->running_duration += duration_of_last_state;
+		sandbox_refresh_running_duration(sandbox, now);
+		perf_counters_switch_out(sandbox->perf_counters);
 		local_runqueue_delete(sandbox);
+		module_reservation_charge(&sandbox->module->reservation, duration_of_last_state,
+		                          &sandbox->absolute_deadline);
 		sandbox_free_linear_memory(sandbox);
 		break;
 	}
@@ -44,6 +48,7 @@ sandbox_set_as_returned(struct sandbox *sandbox, sandbox_state_t last_state)
 	}
 	}
 
+	sandbox_trace_transition(sandbox, last_state, now);
 	sandbox->last_state_change_timestamp = now;
 	sandbox->state                       = SANDBOX_RETURNED;
 
@@ -6,6 +6,8 @@
 #include "arch/getcycles.h"
 #include "local_runqueue.h"
 #include "panic.h"
+#include "sandbox_functions.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
 
 /**
@@ -41,8 +43,13 @@ sandbox_set_as_runnable(struct sandbox *sandbox, sandbox_state_t last_state)
 		break;
 	}
 	case SANDBOX_RUNNING: {
-		sandbox->running_duration += duration_of_last_state;
-		/* No need to add to runqueue, as already on it */
+		sandbox_refresh_running_duration(sandbox, now);
+		perf_counters_switch_out(sandbox->perf_counters);
+		bool is_postponed = module_reservation_charge(&sandbox->module->reservation, duration_of_last_state,
+		                                              &sandbox->absolute_deadline);
+		/* Already on runqueue, but reorder if the priority is derived from running_duration or the deadline
+		 * was postponed by the module's reservation */
+		if (is_postponed || local_runqueue_is_priority_dynamic()) local_runqueue_update(sandbox);
 		break;
 	}
 	default: {
@@ -51,6 +58,7 @@ sandbox_set_as_runnable(struct sandbox *sandbox, sandbox_state_t last_state)
 	}
 	}
 
+	sandbox_trace_transition(sandbox, last_state, now);
 	sandbox->last_state_change_timestamp = now;
 	sandbox->state                       = SANDBOX_RUNNABLE;
 
@@ -5,6 +5,7 @@
 
 #include "arch/getcycles.h"
 #include "panic.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
 
 static inline void
@@ -20,8 +21,10 @@ sandbox_set_as_running(struct sandbox *sandbox, sandbox_state_t last_state)
 	switch (last_state) {
 	case SANDBOX_RUNNABLE: {
 		sandbox->runnable_duration += duration_of_last_state;
+		sandbox->running_refresh_timestamp = now;
 		current_sandbox_set(sandbox);
-		runtime_worker_threads_deadline[worker_thread_idx] = sandbox->absolute_deadline;
+		perf_counters_switch_in();
+		runtime_worker_threads_deadline[worker_thread_idx].deadline = sandbox->absolute_deadline;
 		/* Does not handle context switch because the caller knows if we need to use fast or slow switched */
 		break;
 	}
@@ -31,6 +34,7 @@ sandbox_set_as_running(struct sandbox *sandbox, sandbox_state_t last_state)
 	}
 	}
 
+	sandbox_trace_transition(sandbox, last_state, now);
 	sandbox->last_state_change_timestamp = now;
 	sandbox->state                       = SANDBOX_RUNNING;
 
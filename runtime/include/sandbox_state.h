@@ -2,6 +2,7 @@
 
 #include <stdatomic.h>
 
+#include "counter_shard.h"
 #include "debuglog.h"
 #include "likely.h"
 #include "panic.h"
@@ -48,32 +49,28 @@ sandbox_state_log_transition(uint64_t sandbox_id, sandbox_state_t last_state, sa
 #endif
 }
 
-#ifdef LOG_SANDBOX_COUNT
-extern _Atomic uint32_t sandbox_state_count[SANDBOX_STATE_COUNT];
-#endif
+/*
+ * Number of sandboxes in each terminal state, sharded by thread and summed when read. A shard may go negative if a
+ * sandbox leaves a state on another thread than the one it entered it on, but the sum does not. See counter_shard.h
+ */
+struct sandbox_state_count_shard {
+	_Atomic int64_t count[SANDBOX_STATE_COUNT];
+} CACHE_ALIGNED;
 
-static inline void
-sandbox_count_initialize()
-{
-#ifdef LOG_SANDBOX_COUNT
-	for (int i = 0; i < SANDBOX_STATE_COUNT; i++) atomic_init(&sandbox_state_count[i], 0);
-#endif
-}
+extern struct sandbox_state_count_shard *sandbox_state_count_shards;
+
+void    sandbox_count_initialize(void);
+int64_t sandbox_state_count_sum(sandbox_state_t state);
 
 static inline void
 runtime_sandbox_total_increment(sandbox_state_t state)
 {
-#ifdef LOG_SANDBOX_COUNT
-	if (!sandbox_state_is_terminal[state]) panic("Unexpectedly logging intermediate transition state");
-	atomic_fetch_add(&sandbox_state_count[state], 1);
-#endif
+	assert(sandbox_state_is_terminal[state]);
+	counter_shard_add(&sandbox_state_count_shards[counter_shard_idx].count[state], 1);
 }
 
 static inline void
 runtime_sandbox_total_decrement(sandbox_state_t state)
 {
-#ifdef LOG_SANDBOX_COUNT
-	if (atomic_load(&sandbox_state_count[state]) == 0) panic("Underflow of %s\n", sandbox_state_stringify(state));
-	atomic_fetch_sub(&sandbox_state_count[state], 1);
-#endif
+	counter_shard_add(&sandbox_state_count_shards[counter_shard_idx].count[state], -1);
 }
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sandbox_state.h"
+#include "sandbox_types.h"
+#include "types.h"
+#include "worker_thread.h"
+
+/*
+ * Flight recorder of sandbox state changes, compiled in with LOG_SANDBOX_TRACE and enabled at runtime by setting
+ * SLEDGE_SANDBOX_TRACE to a path. Every state change records the span of the state the sandbox leaves to a ring of the
+ * calling worker. Rings have a fixed capacity and overwrite their oldest events, so memory and the cost of an event are
+ * bounded regardless of load. When the runtime exits, the rings are written to the path as a Chrome JSON trace, which
+ * Perfetto (ui.perfetto.dev) and chrome://tracing open.
+ *
+ * Without LOG_SANDBOX_TRACE, sandbox_trace_record compiles to nothing.
+ */
+
+/* Default events per worker ring. Set with SLEDGE_SANDBOX_TRACE_EVENTS, rounded up to a power of two */
+#define SANDBOX_TRACE_DEFAULT_RING_CAPACITY 65536
+
+/* Pseudo-state of the span from the arrival of a request to the allocation of its sandbox */
+#define SANDBOX_TRACE_QUEUED SANDBOX_STATE_COUNT
+
+struct sandbox_trace_event {
+	uint64_t       start; /* cycles */
+	uint64_t       end;   /* cycles */
+	uint64_t       sandbox_id;
+	struct module *module;
+	uint32_t       state; /* The state spanning start to end, or SANDBOX_TRACE_QUEUED */
+};
+
+struct sandbox_trace_ring {
+	_Atomic uint64_t            head; /* Events ever recorded. Only written by the owning worker */
+	struct sandbox_trace_event *events;
+} CACHE_ALIGNED;
+
+extern struct sandbox_trace_ring *sandbox_trace_rings;
+extern uint64_t                   sandbox_trace_ring_capacity;
+extern _Atomic bool               sandbox_trace_is_enabled;
+
+void sandbox_trace_initialize(char *path, uint64_t capacity);
+void sandbox_trace_dump(void);
+
+/**
+ * Records that a sandbox was in a state from start to end
+ * @param sandbox
+ * @param state the state the sandbox is leaving, or SANDBOX_TRACE_QUEUED
+ * @param start cycles
+ * @param end cycles
+ */
+static inline void
+sandbox_trace_record(struct sandbox *sandbox, uint32_t state, uint64_t start, uint64_t end)
+{
+#ifdef LOG_SANDBOX_TRACE
+	if (!atomic_load_explicit(&sandbox_trace_is_enabled, memory_order_relaxed)) return;
+
+	struct sandbox_trace_ring * ring  = &sandbox_trace_rings[worker_thread_idx];
+	uint64_t                    head  = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	struct sandbox_trace_event *event = &ring->events[head & (sandbox_trace_ring_capacity - 1)];
+
+	event->start      = start;
+	event->end        = end;
+	event->sandbox_id = sandbox->id;
+	event->module     = sandbox->module;
+	event->state      = state;
+
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+#endif
+}
+
+/**
+ * Records the span of the state a sandbox is leaving. Call before updating last_state_change_timestamp
+ * @param sandbox
+ * @param last_state
+ * @param now cycles
+ */
+static inline void
+sandbox_trace_transition(struct sandbox *sandbox, sandbox_state_t last_state, uint64_t now)
+{
+	/* Sandboxes that fail to initialize never set last_state_change_timestamp */
+	uint64_t start = sandbox->last_state_change_timestamp != 0 ? sandbox->last_state_change_timestamp : now;
+	sandbox_trace_record(sandbox, last_state, start, now);
+}
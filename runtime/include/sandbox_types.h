@@ -10,6 +10,7 @@
 #include "http_parser.h"
 #include "http_request.h"
 #include "module.h"
+#include "perf_counters.h"
 #include "ps_list.h"
 #include "sandbox_state.h"
 
@@ -17,10 +18,6 @@
 #define SANDBOX_MAX_FD_COUNT                  32
 #define SANDBOX_MAX_MEMORY                    (1L << 32) /* 4GB */
 
-#ifdef LOG_SANDBOX_MEMORY_PROFILE
-#define SANDBOX_PAGE_ALLOCATION_TIMESTAMP_COUNT 1024
-#endif
-
 /*********************
  * Structs and Types *
  ********************/
@@ -29,39 +26,54 @@ struct sandbox_io_handle {
 	int file_descriptor;
 };
 
+/*
+ * Fields are grouped by how often they are accessed. The first cache line holds the state touched by every scheduling
+ * decision and context switch, followed by the register context. Fields only used while a sandbox is set up or torn
+ * down and the HTTP state are at the end, so they do not dilute the cache lines of the hot path.
+ */
 struct sandbox {
-	uint64_t        id;
+	/* Hot: read or written by the scheduler on every decision */
 	sandbox_state_t state;
+	uint64_t        absolute_deadline;
+	/* Used for the scheduling runqueue as an in-place linked list data structure. */
+	/* The variable name "list" is used for ps_list's default name-based MACROS. */
+	struct ps_list list;
+	struct module *module;                      /* the module this is an instance of */
+	uint64_t       last_state_change_timestamp; /* Used for bookkeeping of actual execution time */
+	uint64_t       running_duration;            /* cycles. Read by LLF and SRPT */
+	uint64_t       estimated_execution;         /* cycles. Copied from the request */
 
-	uint32_t sandbox_size; /* The struct plus enough buffer to hold the request or response (sized off largest) */
+	struct arch_context ctxt CACHE_ALIGNED; /* register context for context switch. */
 
+	/* Warm: used while the sandbox executes */
+	uint64_t id;
 	void *   linear_memory_start;    /* after sandbox struct */
 	uint32_t linear_memory_size;     /* from after sandbox struct */
 	uint64_t linear_memory_max_size; /* 4GB */
 
+	uint64_t running_refresh_timestamp; /* Up to when the current run is included in running_duration */
+
 	void *   stack_start;
 	uint32_t stack_size;
 
-	struct arch_context ctxt; /* register context for context switch. */
-
-	uint64_t request_arrival_timestamp;   /* Timestamp when request is received */
-	uint64_t allocation_timestamp;        /* Timestamp when sandbox is allocated */
-	uint64_t response_timestamp;          /* Timestamp when response is sent */
-	uint64_t completion_timestamp;        /* Timestamp when sandbox runs to completion */
-	uint64_t last_state_change_timestamp; /* Used for bookkeeping of actual execution time */
-#ifdef LOG_SANDBOX_MEMORY_PROFILE
-	uint32_t page_allocation_timestamps[SANDBOX_PAGE_ALLOCATION_TIMESTAMP_COUNT];
-	size_t   page_allocation_timestamps_size;
-#endif
-	/* Duration of time (in cycles) that the sandbox is in each state */
+	int32_t arguments_offset; /* actual placement of arguments in the sandbox. */
+	void *  arguments;        /* arguments from request, must be of module->argument_count size. */
+	int32_t return_value;
+
+	/* Duration of time (in cycles) that the sandbox is in each other state */
 	uint64_t initializing_duration;
 	uint64_t runnable_duration;
-	uint64_t running_duration;
 	uint64_t blocked_duration;
 	uint64_t returned_duration;
 
-	uint64_t absolute_deadline;
-	uint64_t total_time; /* From Request to Response */
+	/* Hardware events counted while running. Only counted when SLEDGE_PERF_COUNTERS is set */
+	uint64_t perf_counters[PERF_COUNTERS_EVENT_COUNT];
+
+	/* Pages of linear memory added by expand_memory, and the cycles spent adding them */
+	uint32_t linear_memory_growth_count;
+	uint64_t linear_memory_growth_duration;
+
+	uint64_t relative_deadline; /* cycles. Copied from the request */
 
 	/*
 	 * Unitless estimate of the instantaneous fraction of system capacity required to run the request
@@ -69,11 +81,14 @@ struct sandbox {
 	 */
 	uint64_t admissions_estimate;
 
-	struct module *module; /* the module this is an instance of */
+	/* Cold: used when the sandbox is allocated, responds, or completes */
+	uint32_t sandbox_size; /* The struct plus enough buffer to hold the request or response (sized off largest) */
 
-	int32_t arguments_offset; /* actual placement of arguments in the sandbox. */
-	void *  arguments;        /* arguments from request, must be of module->argument_count size. */
-	int32_t return_value;
+	uint64_t request_arrival_timestamp; /* Timestamp when request is received */
+	uint64_t allocation_timestamp;      /* Timestamp when sandbox is allocated */
+	uint64_t response_timestamp;        /* Timestamp when response is sent */
+	uint64_t completion_timestamp;      /* Timestamp when sandbox runs to completion */
+	uint64_t total_time;                /* From Request to Response */
 
 	int             file_descriptors[SANDBOX_MAX_FD_COUNT];
 	struct sockaddr client_address; /* client requesting connection! */
@@ -86,10 +101,6 @@ struct sandbox {
 	char *  read_buffer;
 	ssize_t read_length, read_size;
 
-	/* Used for the scheduling runqueue as an in-place linked list data structure. */
-	/* The variable name "list" is used for ps_list's default name-based MACROS. */
-	struct ps_list list;
-
 	/*
 	 * The length of the HTTP Request.
 	 * This acts as an offset to the STDOUT of the Sandbox
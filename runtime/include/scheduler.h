@@ -9,6 +9,7 @@
 #include "global_request_scheduler.h"
 #include "global_request_scheduler_deque.h"
 #include "global_request_scheduler_minheap.h"
+#include "local_rejection_queue.h"
 #include "local_runqueue.h"
 #include "local_runqueue_minheap.h"
 #include "local_runqueue_list.h"
@@ -20,52 +21,157 @@
 #include "sandbox_set_as_blocked.h"
 #include "sandbox_set_as_runnable.h"
 #include "sandbox_set_as_running.h"
+#include "scheduler_policy.h"
+#include "worker_pool.h"
+#include "worker_thread.h"
 #include "worker_thread_execute_epoll_loop.h"
 
-enum SCHEDULER
+/* The runtime policy. Worker pools may override it with another policy of the same family */
+extern enum SCHEDULER scheduler;
+
+/**
+ * @returns the scheduling policy of the calling worker's pool
+ */
+static inline enum SCHEDULER
+scheduler_get_policy()
 {
-	SCHEDULER_FIFO = 0,
-	SCHEDULER_EDF  = 1
-};
+	return worker_pools[worker_thread_pool_idx].scheduler;
+}
 
-extern enum SCHEDULER scheduler;
+/**
+ * Rejects a request pulled from the global request scheduler without allocating a sandbox
+ * Rejecting releases the concurrency slot of the module, which takes a lock, so the SIGALRM handler defers the
+ * rejection to the base context of the worker
+ * @param request
+ * @param status_code HTTP status code sent to the client
+ * @param is_preempting true if called from the SIGALRM handler
+ */
+static inline void
+scheduler_reject(struct sandbox_request *request, int status_code, bool is_preempting)
+{
+	if (is_preempting) {
+		local_rejection_queue_add(request, status_code);
+	} else {
+		sandbox_request_reject(request, status_code);
+	}
+}
 
+/**
+ * Drops a request that can no longer meet its deadline, rejecting it without allocating a sandbox
+ * This is a noop unless early drop is enabled
+ * @param request
+ * @param is_preempting true if called from the SIGALRM handler
+ * @returns true if the request was dropped
+ */
+static inline bool
+scheduler_drop_if_infeasible(struct sandbox_request *request, bool is_preempting)
+{
+	if (!runtime_early_drop_enabled) return false;
+
+	int status_code = sandbox_request_check_feasibility(request, __getcycles());
+	if (status_code == 0) return false;
+
+	scheduler_reject(request, status_code, is_preempting);
+	return true;
+}
+
+/**
+ * Periodically sweeps infeasible requests from the global request scheduler of the calling worker's pool
+ * Requests are checked at dequeue anyways, but a sweep releases the admissions estimates of hopeless requests buried
+ * behind higher priority work. The first worker of a pool to observe that a sweep period has elapsed performs the sweep.
+ */
+static inline void
+scheduler_sweep_infeasible()
+{
+	if (runtime_early_drop_sweep_period_us == 0) return;
+
+	struct worker_pool *pool       = &worker_pools[worker_thread_pool_idx];
+	uint64_t            now        = __getcycles();
+	uint64_t            last_sweep = atomic_load_explicit(&pool->early_drop_last_sweep, memory_order_relaxed);
+	if (now - last_sweep < (uint64_t)runtime_early_drop_sweep_period_us * runtime_processor_speed_MHz) return;
+	if (!atomic_compare_exchange_strong(&pool->early_drop_last_sweep, &last_sweep, now)) return;
+
+	global_request_scheduler_minheap_drop_infeasible(worker_thread_pool_idx);
+}
+
+/**
+ * Gets the priority of a sandbox under one of the minheap-based policies (EDF, LLF, SRPT)
+ * Lower values run first
+ * @param sandbox
+ * @returns priority
+ */
+static inline uint64_t
+scheduler_get_priority(struct sandbox *sandbox)
+{
+	switch (scheduler_get_policy()) {
+	case SCHEDULER_LLF:
+		return sandbox_get_priority_llf(sandbox);
+	case SCHEDULER_SRPT:
+		return sandbox_get_priority_srpt(sandbox);
+	default:
+		return sandbox_get_priority(sandbox);
+	}
+}
+
+/**
+ * Selects the next sandbox under one of the minheap-based policies (EDF, LLF, SRPT)
+ * The policies only differ in the priority function the global and local minheaps were initialized with
+ * @param is_preempting true if called from the SIGALRM handler
+ */
 static inline struct sandbox *
-scheduler_edf_get_next()
+scheduler_edf_get_next(bool is_preempting)
 {
-	/* Get the deadline of the sandbox at the head of the local request queue */
-	struct sandbox *        local          = local_runqueue_get_next();
-	uint64_t                local_deadline = local == NULL ? UINT64_MAX : local->absolute_deadline;
-	struct sandbox_request *request        = NULL;
+	/* Get the priority of the sandbox at the head of the local request queue */
+	struct sandbox *local          = local_runqueue_get_next();
+	uint64_t        local_priority = local == NULL ? UINT64_MAX : scheduler_get_priority(local);
+
+	uint64_t global_priority = global_request_scheduler_peek();
+
+	/* Try to pull and allocate a batch from the global queue if higher priority
+	 * The batch is drawn from requests within a quantum of the highest priority request
+	 * These will be placed at the head of the local runqueue */
+	if (global_priority < local_priority) {
+		struct sandbox_request *requests[GLOBAL_REQUEST_SCHEDULER_BATCH_SIZE_MAX];
+		uint64_t                batch_window = (uint64_t)runtime_quantum_us * runtime_processor_speed_MHz;
+
+		/*
+		 * Allocating a sandbox maps its linear memory, so the SIGALRM handler only allocates the request it
+		 * preempts for and leaves the rest to the base context. SRPT priorities are execution estimates rather
+		 * than points in time, so a window of a quantum does not bound them and SRPT pulls one request at a time
+		 */
+		int batch_size_max = GLOBAL_REQUEST_SCHEDULER_BATCH_SIZE_MAX;
+		if (is_preempting || scheduler_get_policy() == SCHEDULER_SRPT) batch_size_max = 1;
 
-	uint64_t global_deadline = global_request_scheduler_peek();
+		int request_count = global_request_scheduler_remove_batch_if_earlier(requests, batch_size_max,
+		                                                                     local_priority, batch_window);
 
-	/* Try to pull and allocate from the global queue if earlier
-	 * This will be placed at the head of the local runqueue */
-	if (global_deadline < local_deadline) {
-		if (global_request_scheduler_remove_if_earlier(&request, local_deadline) == 0) {
+		for (int i = 0; i < request_count; i++) {
+			struct sandbox_request *request = requests[i];
 			assert(request != NULL);
-			assert(request->absolute_deadline < local_deadline);
+			assert(scheduler_get_policy() != SCHEDULER_EDF || request->absolute_deadline < local_priority);
+			if (scheduler_drop_if_infeasible(request, is_preempting)) continue;
+
 			struct sandbox *global = sandbox_allocate(request);
-			if (!global) goto err_allocate;
+			if (!global) {
+				scheduler_reject(request, 503, is_preempting);
+				continue;
+			}
 
 			assert(global->state == SANDBOX_INITIALIZED);
 			sandbox_set_as_runnable(global, SANDBOX_INITIALIZED);
 		}
 	}
 
-/* Return what is at the head of the local runqueue or NULL if empty */
-done:
+	/* Return what is at the head of the local runqueue or NULL if empty */
 	return local_runqueue_get_next();
-err_allocate:
-	client_socket_send(request->socket_descriptor, 503);
-	client_socket_close(request->socket_descriptor, &request->socket_address);
-	free(request);
-	goto done;
 }
 
+/**
+ * Selects the next sandbox under FIFO, rotating the local runqueue if the current sandbox is at its head
+ * @param is_preempting true if called from the SIGALRM handler
+ */
 static inline struct sandbox *
-scheduler_fifo_get_next()
+scheduler_fifo_get_next(bool is_preempting)
 {
 	struct sandbox *sandbox = local_runqueue_get_next();
 
@@ -74,6 +180,7 @@ scheduler_fifo_get_next()
 	if (sandbox == NULL) {
 		/* If the local runqueue is empty, pull from global request scheduler */
 		if (global_request_scheduler_remove(&sandbox_request) < 0) goto err;
+		if (scheduler_drop_if_infeasible(sandbox_request, is_preempting)) goto err;
 
 		sandbox = sandbox_allocate(sandbox_request);
 		if (!sandbox) goto err_allocate;
@@ -89,54 +196,80 @@ scheduler_fifo_get_next()
 done:
 	return sandbox;
 err_allocate:
-	client_socket_send(sandbox_request->socket_descriptor, 503);
-	client_socket_close(sandbox_request->socket_descriptor, &sandbox->client_address);
-	free(sandbox_request);
+	scheduler_reject(sandbox_request, 503, is_preempting);
 err:
 	sandbox = NULL;
 	goto done;
 }
 
+/**
+ * Selects the next sandbox to run, pulling from the global request scheduler if it has higher priority work
+ * @param is_preempting true if called from the SIGALRM handler
+ * @returns the sandbox at the head of the local runqueue, or NULL if empty
+ */
 static inline struct sandbox *
-scheduler_get_next()
+scheduler_get_next(bool is_preempting)
 {
-	switch (scheduler) {
+	switch (scheduler_get_policy()) {
 	case SCHEDULER_EDF:
-		return scheduler_edf_get_next();
+	case SCHEDULER_LLF:
+	case SCHEDULER_SRPT:
+		return scheduler_edf_get_next(is_preempting);
 	case SCHEDULER_FIFO:
-		return scheduler_fifo_get_next();
+		return scheduler_fifo_get_next(is_preempting);
 	default:
 		panic("Unimplemented\n");
 	}
 }
 
+/**
+ * Initializes the global request scheduler of each worker pool
+ */
 static inline void
 scheduler_initialize()
 {
-	switch (scheduler) {
-	case SCHEDULER_EDF:
-		global_request_scheduler_minheap_initialize();
-		break;
-	case SCHEDULER_FIFO:
-		global_request_scheduler_deque_initialize();
-		break;
-	default:
-		panic("Invalid scheduler policy: %u\n", scheduler);
+	for (uint32_t i = 0; i < worker_pools_count; i++) {
+		switch (worker_pools[i].scheduler) {
+		case SCHEDULER_EDF:
+			global_request_scheduler_minheap_initialize(i, sandbox_request_get_priority_fn);
+			break;
+		case SCHEDULER_LLF:
+			global_request_scheduler_minheap_initialize(i, sandbox_request_get_priority_llf_fn);
+			break;
+		case SCHEDULER_SRPT:
+			global_request_scheduler_minheap_initialize(i, sandbox_request_get_priority_srpt_fn);
+			break;
+		case SCHEDULER_FIFO:
+			global_request_scheduler_deque_initialize(i);
+			break;
+		default:
+			panic("Invalid scheduler policy: %u\n", worker_pools[i].scheduler);
+		}
 	}
 }
 
+/**
+ * Initializes the local runqueue of the calling worker using the policy of its pool
+ */
 static inline void
 scheduler_runqueue_initialize()
 {
-	switch (scheduler) {
+	switch (scheduler_get_policy()) {
 	case SCHEDULER_EDF:
-		local_runqueue_minheap_initialize();
+		/* Deadlines are static, except when postponed by a bandwidth reservation, which reorders the sandbox */
+		local_runqueue_minheap_initialize(sandbox_get_priority, false);
+		break;
+	case SCHEDULER_LLF:
+		local_runqueue_minheap_initialize(sandbox_get_priority_llf, true);
+		break;
+	case SCHEDULER_SRPT:
+		local_runqueue_minheap_initialize(sandbox_get_priority_srpt, true);
 		break;
 	case SCHEDULER_FIFO:
 		local_runqueue_list_initialize();
 		break;
 	default:
-		panic("Invalid scheduler policy: %u\n", scheduler);
+		panic("Invalid scheduler policy: %u\n", scheduler_get_policy());
 	}
 }
 
@@ -157,7 +290,14 @@ scheduler_preempt(ucontext_t *user_context)
 	assert(current != NULL);
 	assert(current->state == SANDBOX_RUNNING);
 
-	struct sandbox *next = scheduler_get_next();
+	/* The LLF and SRPT keys of the current sandbox change as it runs, so refresh its key before comparing it */
+	enum SCHEDULER policy = scheduler_get_policy();
+	if (policy == SCHEDULER_LLF || policy == SCHEDULER_SRPT) {
+		sandbox_refresh_running_duration(current, __getcycles());
+		local_runqueue_update(current);
+	}
+
+	struct sandbox *next = scheduler_get_next(true);
 	assert(next != NULL);
 
 	/* If current equals next, no switch is necessary, so resume execution */
@@ -190,13 +330,17 @@ scheduler_preempt(ucontext_t *user_context)
 		 * become runnable or was just freshly allocated. This means that such EDF preemption context switches
 		 * should always use a fast context.
 		 *
-		 * This is not true under FIFO, where there is no innate ordering between sandboxes. A runqueue is
+		 * LLF and SRPT priorities change as a sandbox runs, so a previously preempted sandbox can become the
+		 * highest priority again and be resumed with a slow context. The same is true under EDF when a module
+		 * with a bandwidth reservation exhausts its budget and the deadline of the preempting sandbox is
+		 * postponed.
+		 *
+		 * This is also not true under FIFO, where there is no innate ordering between sandboxes. A runqueue is
 		 * normally only a single sandbox, but it may have multiple sandboxes when one blocks and the worker
 		 * pulls an addition request. When the blocked sandbox becomes runnable, the executing sandbox can be
 		 * preempted yielding a slow context. This means that FIFO preemption context switches might cause
 		 * either a fast or a slow context to be restored during "round robin" execution.
 		 */
-		assert(scheduler != SCHEDULER_EDF);
 
 		arch_mcontext_restore(&user_context->uc_mcontext, &next->ctxt);
 		break;
@@ -216,6 +360,10 @@ scheduler_print(enum SCHEDULER variant)
 		return "FIFO";
 	case SCHEDULER_EDF:
 		return "EDF";
+	case SCHEDULER_LLF:
+		return "LLF";
+	case SCHEDULER_SRPT:
+		return "SRPT";
 	}
 }
 
@@ -288,7 +436,7 @@ scheduler_yield()
 
 	sandbox_exit(current_sandbox);
 	current_sandbox_set(NULL);
-	runtime_worker_threads_deadline[worker_thread_idx] = UINT64_MAX;
+	runtime_worker_threads_deadline[worker_thread_idx].deadline = UINT64_MAX;
 
 	/* Assumption: Base Worker context should never be preempted */
 	assert(worker_thread_base_context.variant == ARCH_CONTEXT_VARIANT_FAST);
@@ -0,0 +1,9 @@
+#pragma once
+
+enum SCHEDULER
+{
+	SCHEDULER_FIFO = 0,
+	SCHEDULER_EDF  = 1,
+	SCHEDULER_LLF  = 2,
+	SCHEDULER_SRPT = 3
+};
@@ -9,16 +9,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arch/getcycles.h"
 #include "debuglog.h"
 #include "runtime.h"
 #include "worker_thread.h"
 
+/*
+ * Deferred SIGALRM delays are bucketed by powers of two in microseconds
+ * Bucket 0 is < 1us, bucket n is [2^(n-1), 2^n) us, and the last bucket holds all larger delays
+ */
+#define SOFTWARE_INTERRUPT_DEFERRED_SIGALRM_DELAY_BUCKET_COUNT 24
+
+/*
+ * Statistics of the SIGALRMs deferred by a worker. Each worker updates its own entry whenever it clears deferred
+ * SIGALRMs, so entries are padded to cache lines to avoid false sharing
+ */
+struct software_interrupt_deferred_sigalrm_stats {
+	_Atomic volatile sig_atomic_t max;
+	/* Histogram of how long deferred SIGALRMs waited until a scheduling decision */
+	uint32_t delay[SOFTWARE_INTERRUPT_DEFERRED_SIGALRM_DELAY_BUCKET_COUNT];
+} CACHE_ALIGNED;
+
 /************
  * Externs  *
  ***********/
 
 extern _Atomic __thread volatile sig_atomic_t software_interrupt_deferred_sigalrm;
-extern _Atomic volatile sig_atomic_t          software_interrupt_deferred_sigalrm_max[RUNTIME_WORKER_THREAD_CORE_COUNT];
+extern __thread volatile uint64_t             software_interrupt_deferred_sigalrm_timestamp;
+extern struct software_interrupt_deferred_sigalrm_stats *software_interrupt_deferred_sigalrm_stats;
 
 /*************************
  * Public Static Inlines *
@@ -73,6 +91,63 @@ software_interrupt_unmask_signal(int signal)
 	return 0;
 }
 
+/**
+ * Defers a SIGALRM that arrived while the current sandbox was not preemptable
+ * Only called by the SIGALRM handler of the worker that owns the thread-local state
+ */
+static inline void
+software_interrupt_defer_sigalrm(void)
+{
+	/* Only the first deferral since the last scheduling decision starts the clock */
+	if (software_interrupt_deferred_sigalrm == 0) software_interrupt_deferred_sigalrm_timestamp = __getcycles();
+	atomic_fetch_add(&software_interrupt_deferred_sigalrm, 1);
+}
+
+/**
+ * Clears any SIGALRMs deferred since the last scheduling decision, recording how many were deferred and how long
+ * they were delayed. Called whenever the worker is about to run the scheduler.
+ * @returns the number of SIGALRMs that had been deferred
+ */
+static inline int
+software_interrupt_deferred_sigalrm_clear(void)
+{
+	if (likely(software_interrupt_deferred_sigalrm == 0)) return 0;
+
+	uint64_t deferred_timestamp = software_interrupt_deferred_sigalrm_timestamp;
+	int      deferred           = atomic_exchange(&software_interrupt_deferred_sigalrm, 0);
+	if (deferred == 0) return 0;
+
+	struct software_interrupt_deferred_sigalrm_stats *stats =
+	  &software_interrupt_deferred_sigalrm_stats[worker_thread_idx];
+
+	/* Update Max */
+	if (deferred > stats->max) stats->max = deferred;
+
+	/* Update Delay Histogram */
+	uint64_t delay_us = (__getcycles() - deferred_timestamp) / runtime_processor_speed_MHz;
+	int      bucket   = delay_us == 0 ? 0 : 64 - __builtin_clzll(delay_us);
+	if (bucket >= SOFTWARE_INTERRUPT_DEFERRED_SIGALRM_DELAY_BUCKET_COUNT) {
+		bucket = SOFTWARE_INTERRUPT_DEFERRED_SIGALRM_DELAY_BUCKET_COUNT - 1;
+	}
+	stats->delay[bucket]++;
+
+	return deferred;
+}
+
+/**
+ * Replays SIGALRMs deferred while the current sandbox was not preemptable
+ * Assumes the caller just enabled preemption, so the signal is delivered and handled before this returns,
+ * allowing the scheduler to immediately preempt the current sandbox if earlier deadline work is pending
+ */
+static inline void
+software_interrupt_deferred_sigalrm_replay(void)
+{
+	if (software_interrupt_deferred_sigalrm_clear() == 0) return;
+
+	/* A thread-directed signal is handled as a SI_TKILL signal, so it is not propagated to other workers */
+	pthread_kill(pthread_self(), SIGALRM);
+}
+
 /*************************
  * Exports from module.c *
  ************************/
@@ -82,3 +157,4 @@ void software_interrupt_arm_timer(void);
 void software_interrupt_disarm_timer(void);
 void software_interrupt_set_interval_duration(uint64_t cycles);
 void software_interrupt_deferred_sigalrm_max_print(void);
+void software_interrupt_deferred_sigalrm_delay_print(void);
@@ -8,6 +8,8 @@
 #define PAGE_SIZE (unsigned long)(1 << 12)
 #endif
 
+#define CACHE_LINE_SIZE 64
+
 /* For this family of macros, do NOT pass zero as the pow2 */
 #define round_to_pow2(x, pow2)    (((unsigned long)(x)) & (~((pow2)-1)))
 #define round_up_to_pow2(x, pow2) (round_to_pow2(((unsigned long)(x)) + (pow2)-1, (pow2)))
@@ -15,11 +17,12 @@
 #define round_to_page(x)    round_to_pow2(x, PAGE_SIZE)
 #define round_up_to_page(x) round_up_to_pow2(x, PAGE_SIZE)
 
-#define EXPORT       __attribute__((visibility("default")))
-#define IMPORT       __attribute__((visibility("default")))
-#define INLINE       __attribute__((always_inline))
-#define PAGE_ALIGNED __attribute__((aligned(PAGE_SIZE)))
-#define WEAK         __attribute__((weak))
+#define EXPORT        __attribute__((visibility("default")))
+#define IMPORT        __attribute__((visibility("default")))
+#define INLINE        __attribute__((always_inline))
+#define PAGE_ALIGNED  __attribute__((aligned(PAGE_SIZE)))
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#define WEAK          __attribute__((weak))
 
 /* FIXME: per-module configuration? Issue #101 */
 #define WASM_PAGE_SIZE   (1024 * 64) /* 64KB */
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "scheduler_policy.h"
+#include "types.h"
+
+#define WORKER_POOL_MAX             16
+#define WORKER_POOL_NAME_MAX_LENGTH 32
+#define WORKER_POOL_DEFAULT_NAME    "default"
+
+/*
+ * A worker pool is a contiguous range of worker threads, and thus of cores, with its own global request queue and
+ * scheduling policy. Modules are assigned to a pool by name, so long-running modules can be kept off the cores serving
+ * latency-critical ones. Without configuration, a single default pool holds all workers.
+ *
+ * Pools of a minheap-based runtime can mix EDF, LLF, and SRPT, which only differ in priority functions. Pools of a FIFO
+ * runtime are all FIFO.
+ *
+ * When NUMA is enabled, a pool spanning several nodes is split into a group of node-local pools, each with its own
+ * request queue. The listener routes each request to the least loaded pool of its module's group, and a worker whose
+ * pool is empty steals from the other pools of its group.
+ *
+ * The counters written at runtime start on their own cache line, so updating them does not invalidate the read-mostly
+ * configuration that workers and the listener read on every scheduling decision, nor that of the neighboring pool.
+ */
+struct worker_pool {
+	char             name[WORKER_POOL_NAME_MAX_LENGTH];
+	enum SCHEDULER   scheduler;
+	uint32_t         first_worker_idx;
+	uint32_t         worker_count;
+	int              node;        /* NUMA node of the workers. 0 unless NUMA is enabled */
+	uint32_t         group_idx;   /* Index of the first pool of the group split from the same configured pool */
+	uint32_t         group_count; /* Number of pools in the group */
+
+	_Atomic uint32_t queued_count CACHE_ALIGNED; /* Requests in the request queue. Only tracked if group_count > 1 */
+	_Atomic uint64_t early_drop_last_sweep;      /* Timestamp of the last sweep of infeasible requests */
+	_Atomic uint32_t sleeping_count;             /* Idle workers sleeping until a request is added */
+};
+
+extern struct worker_pool worker_pools[WORKER_POOL_MAX];
+extern uint32_t           worker_pools_count;
+extern uint64_t *         worker_pools_cross_node_steals;
+
+void     worker_pools_initialize(char *specification);
+int      worker_pools_find(const char *name);
+uint32_t worker_pools_get_idx_of_worker(int worker_idx);
+uint32_t worker_pools_route(uint32_t pool_idx);
+void     worker_pools_print(void);
+void     worker_pools_cross_node_steals_print(void);
@@ -6,6 +6,7 @@
 extern __thread struct arch_context worker_thread_base_context;
 extern __thread int                 worker_thread_epoll_file_descriptor;
 extern __thread int                 worker_thread_idx;
+extern __thread uint32_t            worker_thread_pool_idx;
 
 void *worker_thread_main(void *return_code);
 
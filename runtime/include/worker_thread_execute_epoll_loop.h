@@ -12,8 +12,68 @@
 #include "sandbox_state.h"
 #include "sandbox_types.h"
 #include "worker_thread.h"
+#include "worker_thread_idle.h"
 
 
+/**
+ * Handles events returned by the local thread's epoll instance
+ * @param epoll_events
+ * @param descriptor_count number of events
+ */
+static inline void
+worker_thread_process_epoll_events(struct epoll_event *epoll_events, int descriptor_count)
+{
+	for (int i = 0; i < descriptor_count; i++) {
+		/* The eventfd used to wake the idle worker carries no sandbox */
+		if (epoll_events[i].data.ptr == NULL) {
+			worker_thread_idle_eventfd_drain();
+			continue;
+		}
+
+		if (epoll_events[i].events & (EPOLLIN | EPOLLOUT)) {
+			/* Re-add to runqueue if blocked */
+			struct sandbox *sandbox = (struct sandbox *)epoll_events[i].data.ptr;
+			assert(sandbox);
+
+			if (sandbox->state == SANDBOX_BLOCKED) {
+				sandbox_set_as_runnable(sandbox, SANDBOX_BLOCKED);
+			}
+		} else if (epoll_events[i].events & (EPOLLERR | EPOLLHUP)) {
+			/* Mystery: This seems to never fire. Why? Issue #130 */
+
+			/* Close socket and set as error on socket error or unexpected client hangup */
+			struct sandbox *sandbox = (struct sandbox *)epoll_events[i].data.ptr;
+			int             error   = 0;
+			socklen_t       errlen  = sizeof(error);
+			getsockopt(epoll_events[i].data.fd, SOL_SOCKET, SO_ERROR, (void *)&error, &errlen);
+
+			if (error > 0) {
+				debuglog("Socket error: %s", strerror(error));
+			} else if (epoll_events[i].events & EPOLLHUP) {
+				debuglog("Client Hungup");
+			} else {
+				debuglog("Unknown Socket error");
+			}
+
+			switch (sandbox->state) {
+			case SANDBOX_SET_AS_RETURNED:
+			case SANDBOX_RETURNED:
+			case SANDBOX_SET_AS_COMPLETE:
+			case SANDBOX_COMPLETE:
+			case SANDBOX_SET_AS_ERROR:
+			case SANDBOX_ERROR:
+				panic("Expected to have closed socket");
+			default:
+				client_socket_send(sandbox->client_socket_descriptor, 503);
+				sandbox_close_http(sandbox);
+				sandbox_set_as_error(sandbox, sandbox->state);
+			}
+		} else {
+			panic("Mystery epoll event!\n");
+		};
+	}
+}
+
 /**
  * Run all outstanding events in the local thread's epoll loop
  */
@@ -33,48 +93,6 @@ worker_thread_execute_epoll_loop(void)
 
 		if (descriptor_count == 0) break;
 
-		for (int i = 0; i < descriptor_count; i++) {
-			if (epoll_events[i].events & (EPOLLIN | EPOLLOUT)) {
-				/* Re-add to runqueue if blocked */
-				struct sandbox *sandbox = (struct sandbox *)epoll_events[i].data.ptr;
-				assert(sandbox);
-
-				if (sandbox->state == SANDBOX_BLOCKED) {
-					sandbox_set_as_runnable(sandbox, SANDBOX_BLOCKED);
-				}
-			} else if (epoll_events[i].events & (EPOLLERR | EPOLLHUP)) {
-				/* Mystery: This seems to never fire. Why? Issue #130 */
-
-				/* Close socket and set as error on socket error or unexpected client hangup */
-				struct sandbox *sandbox = (struct sandbox *)epoll_events[i].data.ptr;
-				int             error   = 0;
-				socklen_t       errlen  = sizeof(error);
-				getsockopt(epoll_events[i].data.fd, SOL_SOCKET, SO_ERROR, (void *)&error, &errlen);
-
-				if (error > 0) {
-					debuglog("Socket error: %s", strerror(error));
-				} else if (epoll_events[i].events & EPOLLHUP) {
-					debuglog("Client Hungup");
-				} else {
-					debuglog("Unknown Socket error");
-				}
-
-				switch (sandbox->state) {
-				case SANDBOX_SET_AS_RETURNED:
-				case SANDBOX_RETURNED:
-				case SANDBOX_SET_AS_COMPLETE:
-				case SANDBOX_COMPLETE:
-				case SANDBOX_SET_AS_ERROR:
-				case SANDBOX_ERROR:
-					panic("Expected to have closed socket");
-				default:
-					client_socket_send(sandbox->client_socket_descriptor, 503);
-					sandbox_close_http(sandbox);
-					sandbox_set_as_error(sandbox, sandbox->state);
-				}
-			} else {
-				panic("Mystery epoll event!\n");
-			};
-		}
+		worker_thread_process_epoll_events(epoll_events, descriptor_count);
 	}
 }
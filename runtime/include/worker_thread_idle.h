@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arch/getcycles.h"
+#include "runtime.h"
+#include "types.h"
+
+/*
+ * Buckets of the wakeup latency histogram. Bucket 0 holds latencies below 1us, and bucket i latencies of
+ * [2^(i-1), 2^i) us. The last bucket is unbounded.
+ */
+#define WORKER_THREAD_IDLE_WAKEUP_BUCKET_COUNT 16
+
+/*
+ * A worker without work spins for runtime_worker_idle_spin_us, polling its epoll instance and the global request
+ * queue, and then sleeps in epoll_wait. Each worker adds an eventfd to its epoll instance, so a sleeping worker is woken
+ * either by I/O of its blocked sandboxes or by whoever adds a request to the queue of its pool.
+ *
+ * A worker announces that it is about to sleep before checking the request queue a final time, and adders look for
+ * sleeping workers after adding, so a request is either found by the worker or wakes it.
+ */
+struct worker_thread_idle {
+	_Atomic bool     is_sleeping;
+	int              eventfd;
+	_Atomic uint64_t wake_timestamp; /* cycles. When a waker claimed the sleeping worker */
+	uint32_t         wakeup_latency[WORKER_THREAD_IDLE_WAKEUP_BUCKET_COUNT]; /* Histogram of wakeups, in us */
+} CACHE_ALIGNED;
+
+extern struct worker_thread_idle *worker_thread_idle;
+extern __thread uint64_t          worker_thread_idle_since;
+
+void            worker_thread_idle_initialize(void);
+void            worker_thread_idle_eventfd_initialize(void);
+void            worker_thread_idle_eventfd_drain(void);
+struct sandbox *worker_thread_idle_sleep(void);
+void            worker_thread_idle_wake(uint32_t pool_idx);
+void            worker_thread_idle_wakeup_latency_print(void);
+
+/**
+ * Called when the scheduler found nothing to run. Starts the spinning period on the first call after the worker ran a
+ * sandbox, and reports when the period has elapsed
+ * @returns true if the worker should sleep
+ */
+static inline bool
+worker_thread_idle_should_sleep(void)
+{
+	if (!runtime_worker_idle_sleep_enabled) return false;
+
+	uint64_t now = __getcycles();
+	if (worker_thread_idle_since == 0) {
+		worker_thread_idle_since = now;
+		return false;
+	}
+
+	return now - worker_thread_idle_since >= (uint64_t)runtime_worker_idle_spin_us * runtime_processor_speed_MHz;
+}
+
+/**
+ * Ends the idle period of the worker, so it spins again the next time it runs out of work
+ */
+static inline void
+worker_thread_idle_reset(void)
+{
+	worker_thread_idle_since = 0;
+}
@@ -2,8 +2,14 @@
 #include <unistd.h>
 
 #include "admissions_control.h"
+#include "arch/getcycles.h"
 #include "debuglog.h"
+#include "module_database.h"
+#include "module_slo.h"
 #include "client_socket.h"
+#include "runtime.h"
+#include "types.h"
+#include "worker_thread.h"
 
 /*
  * Unitless estimate of the instantaneous fraction of system capacity required to complete all previously
@@ -20,6 +26,36 @@ uint64_t         admissions_control_capacity;
 
 const double admissions_control_overhead = 0.2;
 
+/*
+ * Feedback Controller
+ *
+ * When enabled, the listener periodically adjusts admissions_control_capacity between a floor and the raw capacity of
+ * the workers. Capacity is decreased multiplicatively when the deadline miss ratio or the mean queueing delay
+ * (allocation_timestamp - request_arrival_timestamp, as a fraction of the relative deadline) observed since the last
+ * adjustment exceeds its target, and is otherwise increased additively. The static overhead only sets the initial
+ * capacity.
+ *
+ * Completions and deadline misses are the on time and late outcomes counted for the SLOs of the modules. Workers
+ * record queueing delays in their own cache-aligned counters, which only the listener reads.
+ */
+struct admissions_control_worker_outcomes {
+	_Atomic uint64_t completions; /* With a relative deadline, which the queueing delay is relative to */
+	_Atomic uint64_t queueing;    /* Sum of queueing delay / relative deadline in units of the granularity */
+} CACHE_ALIGNED;
+
+bool admissions_control_feedback_enabled = false;
+
+static struct admissions_control_worker_outcomes *admissions_control_outcomes = NULL;
+
+/* Listener-only state */
+static uint64_t admissions_control_max_capacity;
+static uint64_t admissions_control_min_capacity;
+static uint64_t admissions_control_last_adjustment;
+static uint64_t admissions_control_last_completions;
+static uint64_t admissions_control_last_deadline_misses;
+static uint64_t admissions_control_last_slo_completions;
+static uint64_t admissions_control_last_queueing;
+
 void
 admissions_control_initialize()
 {
@@ -27,7 +63,112 @@ admissions_control_initialize()
 	atomic_init(&admissions_control_admitted, 0);
 	admissions_control_capacity = runtime_worker_threads_count * ADMISSIONS_CONTROL_GRANULARITY
 	                              * ((double)1.0 - admissions_control_overhead);
+
+	admissions_control_max_capacity = (uint64_t)runtime_worker_threads_count * ADMISSIONS_CONTROL_GRANULARITY;
+	admissions_control_min_capacity = admissions_control_max_capacity
+	                                  * ADMISSIONS_CONTROL_FEEDBACK_MIN_CAPACITY_PERCENT / 100;
+	admissions_control_last_adjustment = __getcycles();
+	admissions_control_outcomes        = runtime_allocate_per_worker(sizeof(struct admissions_control_worker_outcomes));
+#endif
+}
+
+/**
+ * Records the queueing delay of a completed sandbox for the feedback controller
+ * Called by the worker that completed the sandbox
+ * @param queueing_delay cycles between request arrival and sandbox allocation
+ * @param relative_deadline the relative deadline of the request in cycles. Requests without deadlines are ignored
+ */
+void
+admissions_control_record_completion(uint64_t queueing_delay, uint64_t relative_deadline)
+{
+#ifdef ADMISSIONS_CONTROL
+	if (!admissions_control_feedback_enabled || relative_deadline == 0) return;
+
+	struct admissions_control_worker_outcomes *outcomes = &admissions_control_outcomes[worker_thread_idx];
+
+	/* Single writer, so a relaxed load and store is sufficient */
+	atomic_store_explicit(&outcomes->completions,
+	                      atomic_load_explicit(&outcomes->completions, memory_order_relaxed) + 1,
+	                      memory_order_relaxed);
+	uint64_t queueing = queueing_delay >= relative_deadline
+	                      ? ADMISSIONS_CONTROL_GRANULARITY
+	                      : queueing_delay * ADMISSIONS_CONTROL_GRANULARITY / relative_deadline;
+	atomic_store_explicit(&outcomes->queueing,
+	                      atomic_load_explicit(&outcomes->queueing, memory_order_relaxed) + queueing,
+	                      memory_order_relaxed);
+#endif
+}
+
+/**
+ * Adjusts admissions_control_capacity based on the outcomes recorded since the last adjustment
+ * Called by the listener thread before making an admissions decision
+ */
+static inline void
+admissions_control_adjust_capacity()
+{
+	uint64_t now = __getcycles();
+	if (now - admissions_control_last_adjustment
+	    < (uint64_t)ADMISSIONS_CONTROL_FEEDBACK_PERIOD_US * runtime_processor_speed_MHz)
+		return;
+
+	uint64_t completions = 0, queueing = 0;
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		completions += atomic_load_explicit(&admissions_control_outcomes[i].completions, memory_order_relaxed);
+		queueing += atomic_load_explicit(&admissions_control_outcomes[i].queueing, memory_order_relaxed);
+	}
+
+	/*
+	 * Too few completions to judge the capacity by. Wait another feedback period rather than rescanning the workers
+	 * on every admission, but keep the baselines so the next period includes these completions
+	 */
+	uint64_t period_completions = completions - admissions_control_last_completions;
+	if (period_completions < ADMISSIONS_CONTROL_FEEDBACK_MIN_COMPLETIONS) {
+		admissions_control_last_adjustment = now;
+		return;
+	}
+
+	/* Deadline misses are the late outcomes counted for the SLOs of the modules */
+	uint64_t deadline_misses = 0, slo_completions = 0;
+	for (size_t i = 0; i < module_database_count; i++) {
+		uint64_t totals[MODULE_SLO_OUTCOME_COUNT];
+		module_slo_sum(&module_database[i]->slo, totals);
+		deadline_misses += totals[MODULE_SLO_LATE];
+		slo_completions += totals[MODULE_SLO_ON_TIME] + totals[MODULE_SLO_LATE];
+	}
+
+	uint64_t period_slo_completions = slo_completions - admissions_control_last_slo_completions;
+	uint64_t period_deadline_misses = deadline_misses - admissions_control_last_deadline_misses;
+	uint64_t miss_permille          = period_slo_completions > 0
+	                                    ? period_deadline_misses * 1000 / period_slo_completions
+	                                    : 0;
+	uint64_t mean_queueing          = (queueing - admissions_control_last_queueing) / period_completions;
+	uint64_t prior_capacity         = admissions_control_capacity;
+
+	if (miss_permille > ADMISSIONS_CONTROL_FEEDBACK_TARGET_MISS_PERMILLE
+	    || mean_queueing > ADMISSIONS_CONTROL_FEEDBACK_QUEUEING_THRESHOLD) {
+		/* Multiplicative Decrease */
+		admissions_control_capacity -= admissions_control_capacity / 8;
+		if (admissions_control_capacity < admissions_control_min_capacity)
+			admissions_control_capacity = admissions_control_min_capacity;
+	} else {
+		/* Additive Increase */
+		admissions_control_capacity += admissions_control_max_capacity / 100;
+		if (admissions_control_capacity > admissions_control_max_capacity)
+			admissions_control_capacity = admissions_control_max_capacity;
+	}
+
+#ifdef LOG_ADMISSIONS_CONTROL
+	debuglog("Capacity: %lu -> %lu, Miss Ratio: %lu/1000, Mean Queueing: %lu/%d\n", prior_capacity,
+	         admissions_control_capacity, miss_permille, mean_queueing, ADMISSIONS_CONTROL_GRANULARITY);
+#else
+	(void)prior_capacity;
 #endif
+
+	admissions_control_last_adjustment      = now;
+	admissions_control_last_completions     = completions;
+	admissions_control_last_deadline_misses = deadline_misses;
+	admissions_control_last_slo_completions = slo_completions;
+	admissions_control_last_queueing        = queueing;
 }
 
 void
@@ -104,6 +245,8 @@ admissions_control_decide(uint64_t admissions_estimate)
 #ifdef ADMISSIONS_CONTROL
 	if (unlikely(admissions_estimate == 0)) panic("Admissions estimate should never be zero");
 
+	if (admissions_control_feedback_enabled) admissions_control_adjust_capacity();
+
 	uint64_t total_admitted = atomic_load(&admissions_control_admitted);
 
 	if (total_admitted + admissions_estimate >= admissions_control_capacity) {
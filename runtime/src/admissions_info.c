@@ -1,5 +1,11 @@
+#include <stdlib.h>
+
 #include "admissions_info.h"
 #include "debuglog.h"
+#include "perf_window.h"
+#include "worker_thread.h"
+
+bool admissions_info_size_aware_enabled = false;
 
 /**
  * Initializes perf window
@@ -9,15 +15,35 @@ void
 admissions_info_initialize(struct admissions_info *self, int percentile, uint64_t expected_execution,
                            uint64_t relative_deadline)
 {
+	/* Seeded from the module spec and refined by the perf window when admissions control is enabled */
+	atomic_init(&self->estimated_execution, expected_execution);
+	atomic_init(&self->estimate, 0);
+	self->relative_deadline = relative_deadline;
+	self->workers           = NULL;
+	for (int i = 0; i < ADMISSIONS_INFO_SIZE_BUCKET_COUNT; i++) {
+		atomic_init(&self->size_estimate[i], 0);
+		atomic_init(&self->size_estimated_execution[i], 0);
+	}
+
 #ifdef ADMISSIONS_CONTROL
 	assert(relative_deadline > 0);
 	assert(expected_execution > 0);
-	self->relative_deadline = relative_deadline;
-	self->estimate          = admissions_control_calculate_estimate(expected_execution, relative_deadline);
-	debuglog("Initial Estimate: %lu\n", self->estimate);
+	uint64_t estimate = admissions_control_calculate_estimate(expected_execution, relative_deadline);
+	atomic_store_explicit(&self->estimate, estimate, memory_order_relaxed);
+	debuglog("Initial Estimate: %lu\n", estimate);
 	assert(self != NULL);
 
-	perf_window_initialize(&self->perf_window);
+	self->workers = runtime_allocate_per_worker(sizeof(struct admissions_info_worker));
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		perf_window_initialize(&self->workers[i].perf_window);
+		atomic_init(&self->workers[i].estimated_execution, 0);
+		self->workers[i].completion_count = 0;
+		for (int j = 0; j < ADMISSIONS_INFO_SIZE_BUCKET_COUNT; j++) {
+			perf_window_initialize(&self->workers[i].size_perf_windows[j]);
+			atomic_init(&self->workers[i].size_estimated_execution[j], 0);
+			self->workers[i].size_completion_count[j] = 0;
+		}
+	}
 
 	if (unlikely(percentile < 50 || percentile > 99)) panic("Invalid admissions percentile");
 	self->percentile = percentile;
@@ -30,22 +56,103 @@ admissions_info_initialize(struct admissions_info *self, int percentile, uint64_
 #endif
 }
 
+/**
+ * Frees the per-worker estimates
+ * @param self
+ */
+void
+admissions_info_deinitialize(struct admissions_info *self)
+{
+	free(self->workers);
+	self->workers = NULL;
+}
 
 /*
- * Adds an execution value to the perf window and calculates and caches and updated estimate
+ * Merges the per-worker percentiles into the module estimate
+ * This is the mean of the percentiles of the workers that have executed the module, which approximates the percentile
+ * of the union of the windows without having to read and sort the windows of other workers
+ * @param self
+ */
+static inline void
+admissions_info_merge(struct admissions_info *self)
+{
+	uint64_t sum   = 0;
+	uint32_t count = 0;
+
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		uint64_t estimated_execution = atomic_load_explicit(&self->workers[i].estimated_execution,
+		                                                    memory_order_relaxed);
+		if (estimated_execution == 0) continue;
+		sum += estimated_execution;
+		count++;
+	}
+
+	/* The calling worker always has at least one sample */
+	assert(count > 0);
+
+	uint64_t estimated_execution = sum / count;
+	uint64_t estimate = admissions_control_calculate_estimate(estimated_execution, self->relative_deadline);
+	atomic_store_explicit(&self->estimated_execution, estimated_execution, memory_order_relaxed);
+	atomic_store_explicit(&self->estimate, estimate, memory_order_relaxed);
+}
+
+/*
+ * Merges the per-worker percentiles of a size bucket into the bucket estimate
+ * @param self
+ * @param bucket
+ */
+static inline void
+admissions_info_merge_size_bucket(struct admissions_info *self, int bucket)
+{
+	uint64_t sum   = 0;
+	uint32_t count = 0;
+
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		uint64_t estimated_execution = atomic_load_explicit(&self->workers[i].size_estimated_execution[bucket],
+		                                                    memory_order_relaxed);
+		if (estimated_execution == 0) continue;
+		sum += estimated_execution;
+		count++;
+	}
+
+	assert(count > 0);
+
+	uint64_t estimated_execution = sum / count;
+	uint64_t estimate = admissions_control_calculate_estimate(estimated_execution, self->relative_deadline);
+	atomic_store_explicit(&self->size_estimate[bucket], estimate, memory_order_relaxed);
+	atomic_store_explicit(&self->size_estimated_execution[bucket], estimated_execution, memory_order_relaxed);
+}
+
+/*
+ * Adds an execution value to the calling worker's perf window, and periodically merges the per-worker percentiles
+ * into the module estimate
  * @param self
  * @param execution_duration
+ * @param payload_size size of the request body in bytes, or a negative value if not tracked
  */
 void
-admissions_info_update(struct admissions_info *self, uint64_t execution_duration)
+admissions_info_update(struct admissions_info *self, uint64_t execution_duration, ssize_t payload_size)
 {
 #ifdef ADMISSIONS_CONTROL
-	struct perf_window *perf_window = &self->perf_window;
+	struct admissions_info_worker *worker      = &self->workers[worker_thread_idx];
+	struct perf_window *           perf_window = &worker->perf_window;
 
-	LOCK_LOCK(&self->perf_window.lock);
 	perf_window_add(perf_window, execution_duration);
 	uint64_t estimated_execution = perf_window_get_percentile(perf_window, self->percentile, self->control_index);
-	self->estimate = admissions_control_calculate_estimate(estimated_execution, self->relative_deadline);
-	LOCK_UNLOCK(&self->perf_window.lock);
+	atomic_store_explicit(&worker->estimated_execution, estimated_execution, memory_order_relaxed);
+
+	/* Merge on the first completion so the initial estimate is replaced promptly, and then periodically */
+	if (worker->completion_count++ % ADMISSIONS_INFO_MERGE_INTERVAL == 0) admissions_info_merge(self);
+
+	int bucket = admissions_info_get_size_bucket(payload_size);
+	if (bucket == ADMISSIONS_INFO_SIZE_BUCKET_NONE) return;
+
+	struct perf_window *size_perf_window = &worker->size_perf_windows[bucket];
+	perf_window_add(size_perf_window, execution_duration);
+	estimated_execution = perf_window_get_percentile(size_perf_window, self->percentile, self->control_index);
+	atomic_store_explicit(&worker->size_estimated_execution[bucket], estimated_execution, memory_order_relaxed);
+
+	if (worker->size_completion_count[bucket]++ % ADMISSIONS_INFO_MERGE_INTERVAL == 0)
+		admissions_info_merge_size_bucket(self, bucket);
 #endif
 }
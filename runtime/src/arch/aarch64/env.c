@@ -10,4 +10,16 @@ __getcycles(void)
 	return virtual_timer_value;
 }
 
+/**
+ * Reads the frequency of the generic timer, which firmware sets in CNTFRQ_EL0 and the kernel also relies on
+ * @returns timer frequency in Hz, or 0 if firmware left it unset
+ */
+uint64_t
+arch_getcycles_frequency_Hz(void)
+{
+	unsigned long long timer_frequency;
+	asm volatile("mrs %0, cntfrq_el0" : "=r"(timer_frequency));
+	return timer_frequency;
+}
+
 #endif
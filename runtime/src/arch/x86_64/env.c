@@ -1,5 +1,8 @@
 #if defined(X86_64) || defined(x86_64)
 
+#include <cpuid.h>
+#include <stdio.h>
+
 #include "runtime.h"
 
 unsigned long long int
@@ -14,4 +17,37 @@ __getcycles(void)
 	return cpu_time_in_cycles;
 }
 
+/**
+ * Reads the TSC frequency from CPUID. Leaf 0x15 reports the TSC as a ratio of the core crystal clock, which Intel
+ * processors since Skylake report, though some client parts leave the crystal frequency as 0. Hypervisors that
+ * implement the timing leaf 0x40000010 report the TSC frequency of the guest there. Otherwise, as on AMD, the frequency
+ * must be measured
+ * @returns TSC frequency in Hz, or 0 if CPUID does not report it
+ */
+uint64_t
+arch_getcycles_frequency_Hz(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	/* Without an invariant TSC, the frequency follows power states and no value is accurate */
+	if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1 << 8)) == 0)
+		fprintf(stderr, "The TSC is not invariant, so cycle conversions may drift\n");
+
+	if (__get_cpuid_max(0, NULL) >= 0x15) {
+		__cpuid(0x15, eax, ebx, ecx, edx);
+		if (eax != 0 && ebx != 0 && ecx != 0) return (uint64_t)ecx * ebx / eax;
+	}
+
+	/* Bit 31 of ECX of leaf 1 is set when running under a hypervisor */
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 31)) != 0) {
+		__cpuid(0x40000000, eax, ebx, ecx, edx);
+		if (eax >= 0x40000010) {
+			__cpuid(0x40000010, eax, ebx, ecx, edx);
+			if (eax != 0) return (uint64_t)eax * 1000;
+		}
+	}
+
+	return 0;
+}
+
 #endif
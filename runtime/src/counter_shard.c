@@ -0,0 +1,19 @@
+#include <assert.h>
+
+#include "counter_shard.h"
+
+/* Set by worker threads to their index + 1. The listener and other threads keep shard 0 */
+__thread uint32_t counter_shard_idx = 0;
+
+/**
+ * Allocates a zeroed, cache aligned array with one element per counter shard
+ * @param element_size size of an element in bytes
+ * @returns the array
+ */
+void *
+counter_shard_allocate(size_t element_size)
+{
+	assert(runtime_worker_threads_count > 0);
+
+	return runtime_allocate_cache_aligned(counter_shard_count(), element_size);
+}
@@ -28,16 +28,8 @@ current_sandbox_enable_preemption(struct sandbox *sandbox)
 		panic("Recursive call to current_sandbox_enable_preemption\n");
 	}
 
-	if (software_interrupt_deferred_sigalrm > 0) {
-		/* Update Max */
-		if (software_interrupt_deferred_sigalrm > software_interrupt_deferred_sigalrm_max[worker_thread_idx]) {
-			software_interrupt_deferred_sigalrm_max[worker_thread_idx] =
-			  software_interrupt_deferred_sigalrm;
-		}
-
-		software_interrupt_deferred_sigalrm = 0;
-		// TODO: Replay. Does the replay need to be before or after enabling preemption?
-	}
+	/* Replay after enabling preemption, so the handler is able to preempt if earlier deadline work is pending */
+	software_interrupt_deferred_sigalrm_replay();
 }
 
 static inline void
@@ -94,8 +86,6 @@ current_sandbox_start(void)
 		goto err;
 	};
 
-	http_total_increment_2xx();
-
 	sandbox->response_timestamp = __getcycles();
 
 	assert(sandbox->state == SANDBOX_RUNNING);
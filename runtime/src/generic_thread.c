@@ -8,6 +8,8 @@
 __thread uint64_t generic_thread_lock_duration   = 0;
 __thread uint64_t generic_thread_lock_longest    = 0;
 __thread uint64_t generic_thread_start_timestamp = 0;
+/* Locks held by the thread. A signal handler must not take a lock if the thread it interrupted holds one */
+__thread uint32_t generic_thread_locks_held = 0;
 
 void
 generic_thread_initialize()
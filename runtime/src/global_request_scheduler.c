@@ -1,21 +1,24 @@
 #include "global_request_scheduler.h"
 #include "panic.h"
+#include "worker_pool.h"
+#include "worker_thread.h"
+#include "worker_thread_idle.h"
 
 /* Default uninitialized implementations of the polymorphic interface */
 __attribute__((noreturn)) static struct sandbox_request *
-uninitialized_add(void *arg)
+uninitialized_add(uint32_t pool_idx, void *arg)
 {
 	panic("Global Request Scheduler Add was called before initialization\n");
 }
 
 __attribute__((noreturn)) static int
-uninitialized_remove(struct sandbox_request **arg)
+uninitialized_remove(uint32_t pool_idx, struct sandbox_request **arg)
 {
 	panic("Global Request Scheduler Remove was called before initialization\n");
 }
 
 __attribute__((noreturn)) static uint64_t
-uninitialized_peek()
+uninitialized_peek(uint32_t pool_idx)
 {
 	panic("Global Request Scheduler Peek was called before initialization\n");
 }
@@ -39,18 +42,56 @@ global_request_scheduler_initialize(struct global_request_scheduler_config *conf
 
 
 /**
- * Adds a sandbox request to the request scheduler
+ * Records requests removed from the queue of a pool
+ * Queue lengths are only tracked for pools split by NUMA node, where they drive routing
+ * @param pool_idx
+ * @param count
+ */
+static inline void
+global_request_scheduler_record_removal(uint32_t pool_idx, uint32_t count)
+{
+	if (worker_pools[pool_idx].group_count > 1)
+		atomic_fetch_sub_explicit(&worker_pools[pool_idx].queued_count, count, memory_order_relaxed);
+}
+
+/**
+ * Records a request the calling worker took from the queue of another pool of its group
+ * @param pool_idx the pool the request was taken from
+ */
+static inline void
+global_request_scheduler_record_steal(uint32_t pool_idx)
+{
+	global_request_scheduler_record_removal(pool_idx, 1);
+	worker_pools_cross_node_steals[worker_thread_idx]++;
+}
+
+/**
+ * Adds a sandbox request to the request scheduler of its module's worker pool
+ * If the pool was split by NUMA node, the request is routed to the least loaded pool of the group
  * @param sandbox_request
  */
 struct sandbox_request *
 global_request_scheduler_add(struct sandbox_request *sandbox_request)
 {
 	assert(sandbox_request != NULL);
-	return global_request_scheduler.add_fn(sandbox_request);
+
+	uint32_t pool_idx = worker_pools_route(sandbox_request->module->pool_idx);
+	if (worker_pools[pool_idx].group_count > 1)
+		atomic_fetch_add_explicit(&worker_pools[pool_idx].queued_count, 1, memory_order_relaxed);
+
+	struct sandbox_request *added = global_request_scheduler.add_fn(pool_idx, sandbox_request);
+	if (unlikely(added == NULL)) {
+		global_request_scheduler_record_removal(pool_idx, 1);
+		return added;
+	}
+
+	worker_thread_idle_wake(pool_idx);
+	return added;
 }
 
 /**
- * Removes a sandbox request according to the scheduling policy of the variant
+ * Removes a sandbox request from the calling worker's pool according to the scheduling policy of the variant
+ * If the pool is empty, the request is stolen from another pool of its group
  * @param removed_sandbox where to write the adddress of the removed sandbox
  * @returns 0 if successfully returned a sandbox request, -ENOENT if empty, -EAGAIN if atomic operation unsuccessful
  */
@@ -58,11 +99,27 @@ int
 global_request_scheduler_remove(struct sandbox_request **removed_sandbox)
 {
 	assert(removed_sandbox != NULL);
-	return global_request_scheduler.remove_fn(removed_sandbox);
+
+	struct worker_pool *pool = &worker_pools[worker_thread_pool_idx];
+
+	int rc = global_request_scheduler.remove_fn(worker_thread_pool_idx, removed_sandbox);
+	if (rc == 0) {
+		global_request_scheduler_record_removal(worker_thread_pool_idx, 1);
+		return rc;
+	}
+
+	for (uint32_t i = pool->group_idx; rc == -ENOENT && i < pool->group_idx + pool->group_count; i++) {
+		if (i == worker_thread_pool_idx) continue;
+		rc = global_request_scheduler.remove_fn(i, removed_sandbox);
+		if (rc == 0) global_request_scheduler_record_steal(i);
+	}
+
+	return rc;
 }
 
 /**
- * Removes a sandbox request according to the scheduling policy of the variant
+ * Removes a sandbox request from the calling worker's pool according to the scheduling policy of the variant
+ * If the pool is empty, the request is stolen from another pool of its group
  * @param removed_sandbox where to write the adddress of the removed sandbox
  * @param target_deadline the deadline that must be validated before dequeuing
  * @returns 0 if successfully returned a sandbox request, -ENOENT if empty or if no element meets target_deadline,
@@ -72,15 +129,92 @@ int
 global_request_scheduler_remove_if_earlier(struct sandbox_request **removed_sandbox, uint64_t target_deadline)
 {
 	assert(removed_sandbox != NULL);
-	return global_request_scheduler.remove_if_earlier_fn(removed_sandbox, target_deadline);
+
+	struct worker_pool *pool = &worker_pools[worker_thread_pool_idx];
+
+	int rc = global_request_scheduler.remove_if_earlier_fn(worker_thread_pool_idx, removed_sandbox,
+	                                                       target_deadline);
+	if (rc == 0) {
+		global_request_scheduler_record_removal(worker_thread_pool_idx, 1);
+		return rc;
+	}
+	if (pool->group_count == 1 || global_request_scheduler.peek_fn(worker_thread_pool_idx) != UINT64_MAX)
+		return rc;
+
+	for (uint32_t i = pool->group_idx; rc != 0 && i < pool->group_idx + pool->group_count; i++) {
+		if (i == worker_thread_pool_idx) continue;
+		rc = global_request_scheduler.remove_if_earlier_fn(i, removed_sandbox, target_deadline);
+		if (rc == 0) global_request_scheduler_record_steal(i);
+	}
+
+	return rc;
 }
 
 /**
- * Peeks at the priority of the highest priority sandbox request
+ * Removes a batch of sandbox requests from the calling worker's pool according to the scheduling policy of the variant
+ * If the pool is empty, the batch is stolen from another pool of its group
+ * @param removed_sandboxes buffer to write the addresses of the removed sandboxes
+ * @param max_count the capacity of removed_sandboxes
+ * @param target_deadline the deadline that must be validated before dequeuing
+ * @param batch_window requests after the first must be within this distance in priority from the first
+ * @returns the number of removed sandbox requests
+ */
+int
+global_request_scheduler_remove_batch_if_earlier(struct sandbox_request **removed_sandboxes, int max_count,
+                                                 uint64_t target_deadline, uint64_t batch_window)
+{
+	assert(removed_sandboxes != NULL);
+
+	struct worker_pool *pool = &worker_pools[worker_thread_pool_idx];
+
+	int count = global_request_scheduler.remove_batch_if_earlier_fn(worker_thread_pool_idx, removed_sandboxes,
+	                                                                max_count, target_deadline, batch_window);
+	if (count > 0) {
+		global_request_scheduler_record_removal(worker_thread_pool_idx, count);
+		return count;
+	}
+	if (pool->group_count == 1 || global_request_scheduler.peek_fn(worker_thread_pool_idx) != UINT64_MAX)
+		return count;
+
+	for (uint32_t i = pool->group_idx; count == 0 && i < pool->group_idx + pool->group_count; i++) {
+		if (i == worker_thread_pool_idx) continue;
+		count = global_request_scheduler.remove_batch_if_earlier_fn(i, removed_sandboxes, max_count,
+		                                                            target_deadline, batch_window);
+		for (int j = 0; j < count; j++) global_request_scheduler_record_steal(i);
+	}
+
+	return count;
+}
+
+/**
+ * Peeks at the priority of the highest priority sandbox request of the calling worker's pool
+ * If the pool is empty, this is the highest priority of the other pools of its group, which the worker may steal
  * @returns highest priority
  */
 uint64_t
 global_request_scheduler_peek()
 {
-	return global_request_scheduler.peek_fn();
+	struct worker_pool *pool = &worker_pools[worker_thread_pool_idx];
+
+	uint64_t priority = global_request_scheduler.peek_fn(worker_thread_pool_idx);
+	if (priority != UINT64_MAX || pool->group_count == 1) return priority;
+
+	for (uint32_t i = pool->group_idx; i < pool->group_idx + pool->group_count; i++) {
+		if (i == worker_thread_pool_idx) continue;
+		uint64_t sibling_priority = global_request_scheduler.peek_fn(i);
+		if (sibling_priority < priority) priority = sibling_priority;
+	}
+
+	return priority;
+}
+
+/**
+ * Peeks at the priority of the highest priority sandbox request of a pool
+ * @param pool_idx
+ * @returns highest priority
+ */
+uint64_t
+global_request_scheduler_peek_pool(uint32_t pool_idx)
+{
+	return global_request_scheduler.peek_fn(pool_idx);
 }
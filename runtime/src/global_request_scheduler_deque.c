@@ -1,7 +1,9 @@
 #include "global_request_scheduler.h"
 #include "runtime.h"
+#include "worker_pool.h"
 
-static struct deque_sandbox *global_request_scheduler_deque;
+/* One deque per worker pool */
+static struct deque_sandbox *global_request_scheduler_deque[WORKER_POOL_MAX];
 
 /* TODO: Should this be used???  */
 static pthread_mutex_t global_request_scheduler_deque_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -12,12 +14,12 @@ static pthread_mutex_t global_request_scheduler_deque_mutex = PTHREAD_MUTEX_INIT
  * @returns pointer to request if added. NULL otherwise
  */
 static struct sandbox_request *
-global_request_scheduler_deque_add(void *sandbox_request_raw)
+global_request_scheduler_deque_add(uint32_t pool_idx, void *sandbox_request_raw)
 {
 	struct sandbox_request *sandbox_request = (struct sandbox_request *)sandbox_request_raw;
 	int                     return_code     = 1;
 
-	return_code = deque_push_sandbox(global_request_scheduler_deque, &sandbox_request);
+	return_code = deque_push_sandbox(global_request_scheduler_deque[pool_idx], &sandbox_request);
 
 	if (return_code != 0) return NULL;
 	return sandbox_request_raw;
@@ -33,33 +35,49 @@ global_request_scheduler_deque_add(void *sandbox_request_raw)
  * @returns 0 if successfully returned a sandbox request, -ENOENT if empty, -EAGAIN if atomic instruction unsuccessful
  */
 static int
-global_request_scheduler_deque_remove(struct sandbox_request **removed_sandbox_request)
+global_request_scheduler_deque_remove(uint32_t pool_idx, struct sandbox_request **removed_sandbox_request)
 {
-	return deque_steal_sandbox(global_request_scheduler_deque, removed_sandbox_request);
+	return deque_steal_sandbox(global_request_scheduler_deque[pool_idx], removed_sandbox_request);
 }
 
 static int
-global_request_scheduler_deque_remove_if_earlier(struct sandbox_request **removed_sandbox_request,
-                                                 uint64_t                 target_deadline)
+global_request_scheduler_deque_remove_if_earlier(uint32_t pool_idx, struct sandbox_request **removed_sandbox_request,
+                                                 uint64_t target_deadline)
 {
 	panic("Deque variant does not support this call\n");
 	return -1;
 }
 
+static int
+global_request_scheduler_deque_remove_batch_if_earlier(uint32_t                 pool_idx,
+                                                       struct sandbox_request **removed_sandbox_requests,
+                                                       int max_count, uint64_t target_deadline, uint64_t batch_window)
+{
+	panic("Deque variant does not support this call\n");
+	return -1;
+}
+
+/**
+ * Initializes the deque of a worker pool and registers the variant against the polymorphic interface
+ * @param pool_idx
+ */
 void
-global_request_scheduler_deque_initialize()
+global_request_scheduler_deque_initialize(uint32_t pool_idx)
 {
+	assert(pool_idx < WORKER_POOL_MAX);
+
 	/* Allocate and Initialize the global deque */
-	global_request_scheduler_deque = (struct deque_sandbox *)malloc(sizeof(struct deque_sandbox));
-	assert(global_request_scheduler_deque);
+	global_request_scheduler_deque[pool_idx] = (struct deque_sandbox *)malloc(sizeof(struct deque_sandbox));
+	assert(global_request_scheduler_deque[pool_idx]);
 	/* Note: Below is a Macro */
-	deque_init_sandbox(global_request_scheduler_deque, RUNTIME_MAX_SANDBOX_REQUEST_COUNT);
+	deque_init_sandbox(global_request_scheduler_deque[pool_idx], RUNTIME_MAX_SANDBOX_REQUEST_COUNT);
 
 	/* Register Function Pointers for Abstract Scheduling API */
 	struct global_request_scheduler_config config = {
-		.add_fn               = global_request_scheduler_deque_add,
-		.remove_fn            = global_request_scheduler_deque_remove,
-		.remove_if_earlier_fn = global_request_scheduler_deque_remove_if_earlier
+		.add_fn                     = global_request_scheduler_deque_add,
+		.remove_fn                  = global_request_scheduler_deque_remove,
+		.remove_if_earlier_fn       = global_request_scheduler_deque_remove_if_earlier,
+		.remove_batch_if_earlier_fn = global_request_scheduler_deque_remove_batch_if_earlier
 	};
 
 	global_request_scheduler_initialize(&config);
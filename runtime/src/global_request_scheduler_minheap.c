@@ -1,27 +1,32 @@
 #include <assert.h>
 #include <errno.h>
 
+#include "arch/getcycles.h"
 #include "global_request_scheduler.h"
-#include "listener_thread.h"
+#include "global_request_scheduler_minheap.h"
+#include "lock_profile.h"
 #include "panic.h"
 #include "priority_queue.h"
 #include "runtime.h"
+#include "sandbox_request.h"
+#include "worker_pool.h"
 
-static struct priority_queue *global_request_scheduler_minheap;
+/* One minheap per worker pool */
+static struct priority_queue *global_request_scheduler_minheap[WORKER_POOL_MAX];
 
 /**
- * Pushes a sandbox request to the global deque
+ * Pushes a sandbox request to the global minheap
+ * Callable by the listener thread, and by workers releasing requests queued behind a module's concurrency limit
  * @param sandbox_request
  * @returns pointer to request if added. NULL otherwise
  */
 static struct sandbox_request *
-global_request_scheduler_minheap_add(void *sandbox_request)
+global_request_scheduler_minheap_add(uint32_t pool_idx, void *sandbox_request)
 {
 	assert(sandbox_request);
-	assert(global_request_scheduler_minheap);
-	if (unlikely(!listener_thread_is_running())) panic("%s is only callable by the listener thread\n", __func__);
+	assert(global_request_scheduler_minheap[pool_idx]);
 
-	int return_code = priority_queue_enqueue(global_request_scheduler_minheap, sandbox_request);
+	int return_code = priority_queue_enqueue(global_request_scheduler_minheap[pool_idx], sandbox_request);
 	/* TODO: Propagate -1 to caller. Issue #91 */
 	if (return_code == -ENOSPC) panic("Request Queue is full\n");
 	return sandbox_request;
@@ -32,9 +37,9 @@ global_request_scheduler_minheap_add(void *sandbox_request)
  * @returns 0 if successful, -ENOENT if empty
  */
 int
-global_request_scheduler_minheap_remove(struct sandbox_request **removed_sandbox_request)
+global_request_scheduler_minheap_remove(uint32_t pool_idx, struct sandbox_request **removed_sandbox_request)
 {
-	return priority_queue_dequeue(global_request_scheduler_minheap, (void **)removed_sandbox_request);
+	return priority_queue_dequeue(global_request_scheduler_minheap[pool_idx], (void **)removed_sandbox_request);
 }
 
 /**
@@ -43,11 +48,45 @@ global_request_scheduler_minheap_remove(struct sandbox_request **removed_sandbox
  * @returns 0 if successful, -ENOENT if empty or if request isn't earlier than target_deadline
  */
 int
-global_request_scheduler_minheap_remove_if_earlier(struct sandbox_request **removed_sandbox_request,
-                                                   uint64_t                 target_deadline)
+global_request_scheduler_minheap_remove_if_earlier(uint32_t pool_idx, struct sandbox_request **removed_sandbox_request,
+                                                   uint64_t target_deadline)
 {
-	return priority_queue_dequeue_if_earlier(global_request_scheduler_minheap, (void **)removed_sandbox_request,
-	                                         target_deadline);
+	return priority_queue_dequeue_if_earlier(global_request_scheduler_minheap[pool_idx],
+	                                         (void **)removed_sandbox_request, target_deadline);
+}
+
+/**
+ * Removes a batch of requests in a single lock acquisition
+ * The batch size adapts to queue depth, taking an even share of the queued requests across the workers of the pool,
+ * so a deep queue amortizes lock handoffs while a shallow queue leaves requests for other workers to pull
+ * @param pool_idx
+ * @param removed_sandbox_requests buffer to set to removed sandbox requests
+ * @param max_count capacity of removed_sandbox_requests
+ * @param target_deadline the deadline that the requests must be earlier than to dequeue
+ * @param batch_window requests after the first must be within this distance in priority from the first
+ * @returns the number of removed requests
+ */
+static int
+global_request_scheduler_minheap_remove_batch_if_earlier(uint32_t                 pool_idx,
+                                                         struct sandbox_request **removed_sandbox_requests,
+                                                         int max_count, uint64_t target_deadline,
+                                                         uint64_t batch_window)
+{
+	struct priority_queue *minheap = global_request_scheduler_minheap[pool_idx];
+
+	LOCK_LOCK(&minheap->lock);
+
+	int batch_size = priority_queue_length_nolock(minheap) / worker_pools[pool_idx].worker_count;
+	if (batch_size < 1) batch_size = 1;
+	if (batch_size > max_count) batch_size = max_count;
+
+	int removed_count = priority_queue_dequeue_batch_if_earlier_nolock(minheap,
+	                                                                   (void **)removed_sandbox_requests,
+	                                                                   batch_size, target_deadline, batch_window);
+
+	LOCK_UNLOCK(&minheap->lock);
+
+	return removed_count;
 }
 
 /**
@@ -57,32 +96,62 @@ global_request_scheduler_minheap_remove_if_earlier(struct sandbox_request **remo
  * @returns value of highest priority value in queue or ULONG_MAX if empty
  */
 static uint64_t
-global_request_scheduler_minheap_peek(void)
+global_request_scheduler_minheap_peek(uint32_t pool_idx)
 {
-	return priority_queue_peek(global_request_scheduler_minheap);
+	return priority_queue_peek(global_request_scheduler_minheap[pool_idx]);
 }
 
-uint64_t
-sandbox_request_get_priority_fn(void *element)
+static bool
+global_request_scheduler_minheap_is_infeasible(void *element, void *now)
 {
-	struct sandbox_request *sandbox_request = (struct sandbox_request *)element;
-	return sandbox_request->absolute_deadline;
-};
+	return sandbox_request_check_feasibility((struct sandbox_request *)element, *(uint64_t *)now) != 0;
+}
+
+/**
+ * Removes and rejects requests that can no longer meet their deadlines without allocating sandboxes
+ * Requests are rejected after the lock is released to keep socket writes out of the critical section
+ * @param pool_idx the worker pool whose minheap is swept
+ * @returns the number of requests dropped
+ */
+int
+global_request_scheduler_minheap_drop_infeasible(uint32_t pool_idx)
+{
+	struct sandbox_request *dropped[GLOBAL_REQUEST_SCHEDULER_MINHEAP_DROP_BATCH_SIZE];
+	uint64_t                now = __getcycles();
+
+	int dropped_count = priority_queue_remove_if(global_request_scheduler_minheap[pool_idx],
+	                                             global_request_scheduler_minheap_is_infeasible, &now,
+	                                             (void **)dropped, GLOBAL_REQUEST_SCHEDULER_MINHEAP_DROP_BATCH_SIZE);
+
+	if (worker_pools[pool_idx].group_count > 1)
+		atomic_fetch_sub_explicit(&worker_pools[pool_idx].queued_count, dropped_count, memory_order_relaxed);
 
+	for (int i = 0; i < dropped_count; i++) {
+		sandbox_request_reject(dropped[i], sandbox_request_check_feasibility(dropped[i], now));
+	}
+
+	return dropped_count;
+}
 
 /**
- * Initializes the variant and registers against the polymorphic interface
+ * Initializes the minheap of a worker pool and registers the variant against the polymorphic interface
+ * @param pool_idx
+ * @param get_priority_fn function returning the priority of a sandbox request. Lower values run first
  */
 void
-global_request_scheduler_minheap_initialize()
+global_request_scheduler_minheap_initialize(uint32_t pool_idx, priority_queue_get_priority_fn_t get_priority_fn)
 {
-	global_request_scheduler_minheap = priority_queue_initialize(4096, true, sandbox_request_get_priority_fn);
+	assert(pool_idx < WORKER_POOL_MAX);
+	global_request_scheduler_minheap[pool_idx] = priority_queue_initialize(4096, true, get_priority_fn);
+	lock_profile_register(&global_request_scheduler_minheap[pool_idx]->lock.profile,
+	                      "global_request_scheduler_minheap", worker_pools[pool_idx].name);
 
 	struct global_request_scheduler_config config = {
-		.add_fn               = global_request_scheduler_minheap_add,
-		.remove_fn            = global_request_scheduler_minheap_remove,
-		.remove_if_earlier_fn = global_request_scheduler_minheap_remove_if_earlier,
-		.peek_fn              = global_request_scheduler_minheap_peek
+		.add_fn                     = global_request_scheduler_minheap_add,
+		.remove_fn                  = global_request_scheduler_minheap_remove,
+		.remove_if_earlier_fn       = global_request_scheduler_minheap_remove_if_earlier,
+		.remove_batch_if_earlier_fn = global_request_scheduler_minheap_remove_batch_if_earlier,
+		.peek_fn                    = global_request_scheduler_minheap_peek
 	};
 
 	global_request_scheduler_initialize(&config);
@@ -91,5 +160,8 @@ global_request_scheduler_minheap_initialize()
 void
 global_request_scheduler_minheap_free()
 {
-	priority_queue_free(global_request_scheduler_minheap);
+	for (uint32_t i = 0; i < worker_pools_count; i++) {
+		lock_profile_unregister(&global_request_scheduler_minheap[i]->lock.profile);
+		priority_queue_free(global_request_scheduler_minheap[i]);
+	}
 }
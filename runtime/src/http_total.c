@@ -4,32 +4,41 @@
 #include "http_total.h"
 
 /* 2XX + 4XX should equal sandboxes */
-/* Listener Core Bookkeeping */
-_Atomic uint32_t http_total_requests = 0;
-_Atomic uint32_t http_total_5XX      = 0;
+struct http_total_shard *http_total_shards = NULL;
 
-#ifdef LOG_TOTAL_REQS_RESPS
-_Atomic uint32_t http_total_2XX = 0;
-_Atomic uint32_t http_total_4XX = 0;
-#endif
+void
+http_total_init(void)
+{
+	http_total_shards = counter_shard_allocate(sizeof(struct http_total_shard));
+}
+
+/**
+ * Sums the shards of all threads. Shards are read one at a time, so the sums are not a consistent snapshot
+ * @param total
+ */
+void
+http_total_sum(struct http_total *total)
+{
+	*total = (struct http_total){ 0 };
+	for (uint32_t i = 0; i < counter_shard_count(); i++) {
+		total->requests += atomic_load_explicit(&http_total_shards[i].requests, memory_order_relaxed);
+		total->responses_2XX += atomic_load_explicit(&http_total_shards[i].responses_2XX, memory_order_relaxed);
+		total->responses_4XX += atomic_load_explicit(&http_total_shards[i].responses_4XX, memory_order_relaxed);
+		total->responses_5XX += atomic_load_explicit(&http_total_shards[i].responses_5XX, memory_order_relaxed);
+	}
+}
 
 /* Primarily intended to be called via GDB */
 void
 http_total_log()
 {
-	uint32_t total_reqs = atomic_load(&http_total_requests);
-	uint32_t total_5XX  = atomic_load(&http_total_5XX);
-
-#ifdef LOG_TOTAL_REQS_RESPS
-	uint32_t total_2XX = atomic_load(&http_total_2XX);
-	uint32_t total_4XX = atomic_load(&http_total_4XX);
+	struct http_total total;
+	http_total_sum(&total);
 
-	int64_t total_responses      = total_2XX + total_4XX + total_5XX;
-	int64_t outstanding_requests = (int64_t)total_reqs - total_responses;
+	int64_t total_responses      = total.responses_2XX + total.responses_4XX + total.responses_5XX;
+	int64_t outstanding_requests = total.requests - total_responses;
 
-	debuglog("Requests: %u (%ld outstanding)\n\tResponses: %ld\n\t\t2XX: %u\n\t\t4XX: %u\n\t\t5XX: %u\n",
-	         total_reqs, outstanding_requests, total_responses, total_2XX, total_4XX, total_5XX);
-#else
-	debuglog("Requests: %u\n\tResponses:\n\t\t\t5XX: %u\n", total_reqs, total_5XX);
-#endif
+	debuglog("Requests: %ld (%ld outstanding)\n\tResponses: %ld\n\t\t2XX: %ld\n\t\t4XX: %ld\n\t\t5XX: %ld\n",
+	         total.requests, outstanding_requests, total_responses, total.responses_2XX, total.responses_4XX,
+	         total.responses_5XX);
 };
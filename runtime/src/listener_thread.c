@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include "admissions_info.h"
 #include "arch/getcycles.h"
 #include "client_socket.h"
 #include "global_request_scheduler.h"
@@ -16,8 +17,57 @@ int listener_thread_epoll_file_descriptor;
 
 pthread_t listener_thread_id;
 
+/* The core the listener thread is pinned to. Assigned from the cores available to the process */
+uint32_t listener_thread_core_id = 1;
+
+const char *listener_thread_peek_outcome_labels[LISTENER_THREAD_PEEK_OUTCOME_COUNT] = {
+	[LISTENER_THREAD_PEEK_COMPLETE]  = "complete",
+	[LISTENER_THREAD_PEEK_TRUNCATED] = "truncated",
+	[LISTENER_THREAD_PEEK_TIMED_OUT] = "timed_out",
+};
+
+_Atomic uint64_t listener_thread_peek_outcomes[LISTENER_THREAD_PEEK_OUTCOME_COUNT];
+
 /**
- * Initializes the listener thread, pinned to core 0, and starts to listen for requests
+ * Peeks at the headers of a newly accepted request, retrying until the end of the headers arrives, the buffer is
+ * full, or HTTP_PEEK_TIMEOUT_US elapses. The headers of a client often trail the connection, so a single peek right
+ * after accept would regularly miss them. Counts the outcome so operators can tell how often headers were missed
+ * @param client_socket
+ * @param buffer destination, NUL-terminated on return
+ * @param buffer_size size of buffer, including space for the terminator
+ * @returns the outcome of the peek
+ */
+static enum listener_thread_peek_outcome
+listener_thread_peek_headers(int client_socket, char *buffer, size_t buffer_size)
+{
+	enum listener_thread_peek_outcome outcome;
+
+	uint64_t start   = __getcycles();
+	uint64_t timeout = (uint64_t)HTTP_PEEK_TIMEOUT_US * runtime_processor_speed_MHz;
+	while (true) {
+		ssize_t length = client_socket_peek(client_socket, buffer, buffer_size);
+		if (length > 0 && strstr(buffer, "\r\n\r\n") != NULL) {
+			outcome = LISTENER_THREAD_PEEK_COMPLETE;
+			break;
+		}
+		if (length == (ssize_t)buffer_size - 1) {
+			outcome = LISTENER_THREAD_PEEK_TRUNCATED;
+			break;
+		}
+		if (__getcycles() - start >= timeout) {
+			outcome = LISTENER_THREAD_PEEK_TIMED_OUT;
+			break;
+		}
+	}
+
+	atomic_store_explicit(&listener_thread_peek_outcomes[outcome],
+	                      atomic_load_explicit(&listener_thread_peek_outcomes[outcome], memory_order_relaxed) + 1,
+	                      memory_order_relaxed);
+	return outcome;
+}
+
+/**
+ * Initializes the listener thread, pinned to listener_thread_core_id, and starts to listen for requests
  */
 void
 listener_thread_initialize(void)
@@ -26,7 +76,7 @@ listener_thread_initialize(void)
 	cpu_set_t cs;
 
 	CPU_ZERO(&cs);
-	CPU_SET(LISTENER_THREAD_CORE_ID, &cs);
+	CPU_SET(listener_thread_core_id, &cs);
 
 	/* Setup epoll */
 	listener_thread_epoll_file_descriptor = epoll_create1(0);
@@ -162,12 +212,38 @@ listener_thread_main(void *dummy)
 
 				http_total_increment_request();
 
+				/*
+				 * Peek at the request headers if execution estimates are bucketed by size or clients may
+				 * override deadlines. Headers that have not arrived by the timeout use module defaults
+				 */
+				int      size_bucket       = ADMISSIONS_INFO_SIZE_BUCKET_NONE;
+				uint64_t relative_deadline = module->relative_deadline;
+				if (admissions_info_size_aware_enabled || runtime_deadline_header_enabled) {
+					char peek_buffer[HTTP_PEEK_BUFFER_SIZE];
+					listener_thread_peek_headers(client_socket, peek_buffer, sizeof(peek_buffer));
+
+					long content_length =
+					  client_socket_peek_header_long(peek_buffer, HTTP_REQUEST_CONTENT_LENGTH);
+					size_bucket = admissions_info_get_size_bucket(content_length);
+
+					/* A client budget may only tighten the deadline of a module that has one */
+					long deadline_us = -1;
+					if (runtime_deadline_header_enabled && module->relative_deadline > 0)
+						deadline_us = client_socket_peek_header_long(peek_buffer,
+						                                             HTTP_REQUEST_DEADLINE_US);
+					if (deadline_us > 0 && deadline_us < module->relative_deadline_us)
+						relative_deadline = (uint64_t)deadline_us * runtime_processor_speed_MHz;
+				}
+
 				/*
 				 * Perform admissions control.
 				 * If 0, workload was rejected, so close with 503 and continue
 				 */
-				uint64_t work_admitted = admissions_control_decide(module->admissions_info.estimate);
+				uint64_t work_admitted = admissions_control_decide(
+				  admissions_info_get_estimate_for_deadline(&module->admissions_info, size_bucket,
+				                                            relative_deadline));
 				if (work_admitted == 0) {
+					module_slo_record(&module->slo, MODULE_SLO_REJECTED);
 					client_socket_send(client_socket, 503);
 					if (unlikely(close(client_socket) < 0))
 						debuglog("Error closing client socket - %s", strerror(errno));
@@ -179,10 +255,25 @@ listener_thread_main(void *dummy)
 				struct sandbox_request *sandbox_request =
 				  sandbox_request_allocate(module, module->name, client_socket,
 				                           (const struct sockaddr *)&client_address,
-				                           request_arrival_timestamp, work_admitted);
+				                           request_arrival_timestamp, relative_deadline, work_admitted,
+				                           admissions_info_get_estimated_execution(&module->admissions_info,
+				                                                                   size_bucket));
 
-				/* Add to the Global Sandbox Request Scheduler */
-				global_request_scheduler_add(sandbox_request);
+				/*
+				 * Add to the Global Sandbox Request Scheduler, or the module's queue if it is at its
+				 * concurrency limit. If the queue is also full, close with 503
+				 */
+				if (module_concurrency_admit(&module->concurrency, sandbox_request)
+				    == MODULE_CONCURRENCY_ADMIT_FULL) {
+					module_slo_record(&module->slo, MODULE_SLO_REJECTED);
+					client_socket_send(client_socket, 503);
+					client_socket_close(client_socket, &sandbox_request->socket_address);
+					admissions_control_subtract(work_admitted);
+					module_reservation_release(&module->reservation);
+					free(sandbox_request);
+				} else {
+					module_slo_record(&module->slo, MODULE_SLO_ADMITTED);
+				}
 
 			} /* while true */
 		}         /* for loop */
@@ -0,0 +1,37 @@
+#include "local_rejection_queue.h"
+
+/*
+ * Requests the SIGALRM handler pulled from the global request scheduler but could not run. Rejecting a request releases
+ * the concurrency slot of its module, which takes a lock, so the handler queues the request and the base context of the
+ * worker rejects it. The queue is only added to by the handler and only drained by the base context, which the handler
+ * never interrupts with a current sandbox, so it needs no lock.
+ */
+__thread static struct sandbox_request *local_rejection_queue_head = NULL;
+
+/**
+ * Adds a request to the rejection queue of the calling worker
+ * @param sandbox_request
+ * @param status_code HTTP status code sent to the client when the request is rejected
+ */
+void
+local_rejection_queue_add(struct sandbox_request *sandbox_request, int status_code)
+{
+	assert(sandbox_request != NULL);
+
+	sandbox_request->rejection_status_code = status_code;
+	sandbox_request->next_rejected         = local_rejection_queue_head;
+	local_rejection_queue_head             = sandbox_request;
+}
+
+/**
+ * Rejects all requests in the rejection queue of the calling worker
+ */
+void
+local_rejection_queue_drain()
+{
+	while (local_rejection_queue_head != NULL) {
+		struct sandbox_request *sandbox_request = local_rejection_queue_head;
+		local_rejection_queue_head              = sandbox_request->next_rejected;
+		sandbox_request_reject(sandbox_request, sandbox_request->rejection_status_code);
+	}
+}
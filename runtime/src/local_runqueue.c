@@ -67,3 +67,24 @@ local_runqueue_get_next()
 	assert(local_runqueue.get_next_fn != NULL);
 	return local_runqueue.get_next_fn();
 };
+
+/**
+ * Reorders a sandbox already on the run queue after state its priority depends on has changed
+ * This is a noop for variants that do not register an update function
+ * @param sandbox to reorder
+ */
+void
+local_runqueue_update(struct sandbox *sandbox)
+{
+	if (local_runqueue.update_fn != NULL) local_runqueue.update_fn(sandbox);
+}
+
+/**
+ * @returns true if the priorities of queued sandboxes change whenever they run, so a preempted sandbox must always be
+ * reordered
+ */
+bool
+local_runqueue_is_priority_dynamic()
+{
+	return local_runqueue.is_priority_dynamic;
+}
@@ -70,20 +70,36 @@ local_runqueue_minheap_get_next()
 	return next;
 }
 
+/**
+ * Restores the heap invariant after the priority of a queued sandbox changed by reinserting it
+ * @param sandbox to reorder
+ */
+static void
+local_runqueue_minheap_update(struct sandbox *sandbox)
+{
+	local_runqueue_minheap_delete(sandbox);
+	local_runqueue_minheap_add(sandbox);
+}
+
 /**
  * Registers the PS variant with the polymorphic interface
+ * @param get_priority_fn function returning the priority of a sandbox. Lower values run first
+ * @param is_priority_dynamic true if the priority depends on running_duration, which changes on preemption. Otherwise
+ * a sandbox is only reordered when its deadline is postponed
  */
 void
-local_runqueue_minheap_initialize()
+local_runqueue_minheap_initialize(priority_queue_get_priority_fn_t get_priority_fn, bool is_priority_dynamic)
 {
 	/* Initialize local state */
-	local_runqueue_minheap = priority_queue_initialize(256, false, sandbox_get_priority);
+	local_runqueue_minheap = priority_queue_initialize(256, false, get_priority_fn);
 
 	/* Register Function Pointers for Abstract Scheduling API */
-	struct local_runqueue_config config = { .add_fn      = local_runqueue_minheap_add,
-		                                .is_empty_fn = local_runqueue_minheap_is_empty,
-		                                .delete_fn   = local_runqueue_minheap_delete,
-		                                .get_next_fn = local_runqueue_minheap_get_next };
+	struct local_runqueue_config config = { .add_fn              = local_runqueue_minheap_add,
+		                                .is_empty_fn         = local_runqueue_minheap_is_empty,
+		                                .delete_fn           = local_runqueue_minheap_delete,
+		                                .get_next_fn         = local_runqueue_minheap_get_next,
+		                                .update_fn           = local_runqueue_minheap_update,
+		                                .is_priority_dynamic = is_priority_dynamic };
 
 	local_runqueue_initialize(&config);
 }
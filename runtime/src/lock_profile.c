@@ -0,0 +1,141 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debuglog.h"
+#include "lock_profile.h"
+#include "panic.h"
+
+bool lock_profile_enabled = false;
+
+/* Registered profiles. Locks are registered during startup, so the list is protected by a mutex */
+static struct lock_profile *lock_profile_list  = NULL;
+static pthread_mutex_t      lock_profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Allocates a profile for a lock and registers it if SLEDGE_LOCK_PROFILE is set
+ * @param profile the profile field of the lock, left NULL if profiling is disabled
+ * @param site the structure the lock protects. Must outlive the profile
+ * @param instance the instance of the structure, such as the name of a module
+ */
+void
+lock_profile_register(struct lock_profile **profile, const char *site, const char *instance)
+{
+	*profile = NULL;
+	if (!lock_profile_enabled) return;
+
+	struct lock_profile *self = calloc(1, sizeof(struct lock_profile));
+	if (unlikely(self == NULL)) panic("Failed to allocate lock profile of %s %s\n", site, instance);
+
+	self->site = site;
+	strncpy(self->instance, instance, LOCK_PROFILE_INSTANCE_MAX_LENGTH - 1);
+	self->shards = counter_shard_allocate(sizeof(struct lock_profile_shard));
+
+	pthread_mutex_lock(&lock_profile_mutex);
+	self->next        = lock_profile_list;
+	lock_profile_list = self;
+	pthread_mutex_unlock(&lock_profile_mutex);
+
+	*profile = self;
+}
+
+/**
+ * Unregisters and frees the profile of a lock. The lock must no longer be in use
+ * @param profile the profile field of the lock
+ */
+void
+lock_profile_unregister(struct lock_profile **profile)
+{
+	struct lock_profile *self = *profile;
+	if (self == NULL) return;
+
+	pthread_mutex_lock(&lock_profile_mutex);
+	for (struct lock_profile **link = &lock_profile_list; *link != NULL; link = &(*link)->next) {
+		if (*link == self) {
+			*link = self->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lock_profile_mutex);
+
+	free(self->shards);
+	free(self);
+	*profile = NULL;
+}
+
+/**
+ * Merges the shards of each registered profile and passes them to a visitor. The caller holds lock_profile_mutex
+ * @param visit_fn
+ * @param argument passed to visit_fn
+ */
+static void
+lock_profile_visit_locked(lock_profile_visit_fn_t visit_fn, void *argument)
+{
+	struct latency_histogram *merged = malloc(sizeof(struct latency_histogram));
+	if (merged == NULL) {
+		debuglog("Failed to allocate histogram: %s\n", strerror(errno));
+		return;
+	}
+
+	for (struct lock_profile *profile = lock_profile_list; profile != NULL; profile = profile->next) {
+		memset(merged, 0, sizeof(struct latency_histogram));
+		for (uint32_t i = 0; i < counter_shard_count(); i++) {
+			latency_histogram_merge(merged, &profile->shards[i].wait);
+		}
+		visit_fn(profile, merged, argument);
+	}
+
+	free(merged);
+}
+
+/**
+ * Merges the shards of each registered profile and passes them to a visitor
+ * @param visit_fn
+ * @param argument passed to visit_fn
+ */
+void
+lock_profile_visit(lock_profile_visit_fn_t visit_fn, void *argument)
+{
+	pthread_mutex_lock(&lock_profile_mutex);
+	lock_profile_visit_locked(visit_fn, argument);
+	pthread_mutex_unlock(&lock_profile_mutex);
+}
+
+/**
+ * Prints the profile of a lock
+ * @param profile
+ * @param merged wait histogram in cycles
+ * @param argument unused
+ */
+static void
+lock_profile_print_one(struct lock_profile *profile, struct latency_histogram *merged, void *argument)
+{
+	uint64_t count = latency_histogram_get_count(merged);
+	if (count == 0) return;
+
+	printf("%s %s: %lu, %lu, %u, %u, %u\n", profile->site, profile->instance, count,
+	       (uint64_t)merged->sum / runtime_processor_speed_MHz, latency_histogram_get_quantile(merged, count, 0.5),
+	       latency_histogram_get_quantile(merged, count, 0.99), latency_histogram_get_quantile(merged, count, 1));
+}
+
+/**
+ * Prints the profiles of the locks that were acquired. Called on exit
+ */
+void
+lock_profile_print(void)
+{
+	if (!lock_profile_enabled) return;
+
+	/* Called from a signal handler, which must not wait for a scrape the signal may have interrupted */
+	if (pthread_mutex_trylock(&lock_profile_mutex) != 0) {
+		printf("Lock Profile: busy, skipped\n");
+		return;
+	}
+
+	printf("Lock Profile (acquisitions, total wait us, p50, p99, max wait cycles)\n");
+	lock_profile_visit_locked(lock_profile_print_one, NULL);
+	pthread_mutex_unlock(&lock_profile_mutex);
+	fflush(stdout);
+}
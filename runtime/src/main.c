@@ -1,11 +1,13 @@
 #include <ctype.h>
 #include <dlfcn.h>
+#include <errno.h>
 #include <math.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <sched.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifdef LOG_TO_FILE
@@ -14,26 +16,33 @@
 #include <sys/fcntl.h>
 #endif
 
+#include "admissions_control.h"
+#include "admissions_info.h"
+#include "arch/getcycles.h"
 #include "debuglog.h"
 #include "listener_thread.h"
+#include "lock_profile.h"
+#include "metrics_server.h"
 #include "module.h"
+#include "numa_topology.h"
 #include "panic.h"
+#include "perf_counters.h"
 #include "runtime.h"
+#include "sandbox_perf_log.h"
+#include "sandbox_trace.h"
 #include "sandbox_types.h"
 #include "scheduler.h"
 #include "software_interrupt.h"
+#include "worker_pool.h"
 #include "worker_thread.h"
 
 /* Conditionally used by debuglog when NDEBUG is not set */
 int32_t  debuglog_file_descriptor        = -1;
-uint32_t runtime_first_worker_processor  = 1;
 uint32_t runtime_processor_speed_MHz     = 0;
 uint32_t runtime_total_online_processors = 0;
 uint32_t runtime_worker_threads_count    = 0;
 
 
-FILE *runtime_sandbox_perf_log = NULL;
-
 enum RUNTIME_SIGALRM_HANDLER runtime_sigalrm_handler = RUNTIME_SIGALRM_HANDLER_BROADCAST;
 int                          runtime_worker_core_count;
 
@@ -41,6 +50,15 @@ int                          runtime_worker_core_count;
 bool     runtime_preemption_enabled = true;
 uint32_t runtime_quantum_us         = 5000; /* 5ms */
 
+bool runtime_deadline_header_enabled = false;
+bool runtime_numa_enabled            = false;
+
+bool     runtime_worker_idle_sleep_enabled = true;
+uint32_t runtime_worker_idle_spin_us       = 100;
+
+bool     runtime_early_drop_enabled         = false;
+uint32_t runtime_early_drop_sweep_period_us = 0; /* 0 disables the periodic sweep */
+
 /**
  * Returns instructions on use of CLI if used incorrectly
  * @param cmd - The command the user entered
@@ -52,28 +70,25 @@ runtime_usage(char *cmd)
 }
 
 /**
- * Check the number of cores and the compiler flags and allocate available cores
+ * Finds the cores available to the process and assigns the listener and worker threads to them
+ * Cores are taken from the affinity mask of the process, which also reflects its cgroup cpuset, so the runtime adapts to
+ * the host it runs on. Allocates the per-worker state once the number of workers is known
  */
 void
 runtime_allocate_available_cores()
 {
-	uint32_t max_possible_workers;
+	cpu_set_t available;
+	CPU_ZERO(&available);
+	if (unlikely(sched_getaffinity(0, sizeof(cpu_set_t), &available) != 0)) panic("Failed to get affinity mask\n");
 
-	/* Find the number of processors currently online */
-	runtime_total_online_processors = sysconf(_SC_NPROCESSORS_ONLN);
+	/* Find the number of processors available to the process */
+	runtime_total_online_processors = CPU_COUNT(&available);
 	printf("\tCore Count: %u\n", runtime_total_online_processors);
+	if (runtime_total_online_processors < 2) panic("Runtime requires at least two cores!");
 
-	/* If more than two cores are available, leave core 0 free to run OS tasks */
-	if (runtime_total_online_processors > 2) {
-		runtime_first_worker_processor = 2;
-		max_possible_workers           = runtime_total_online_processors - 2;
-	} else if (runtime_total_online_processors == 2) {
-		runtime_first_worker_processor = 1;
-		max_possible_workers           = runtime_total_online_processors - 1;
-	} else {
-		panic("Runtime requires at least two cores!");
-	}
-
+	/* If more than two cores are available, leave the first free to run OS tasks */
+	uint32_t skipped_cores        = runtime_total_online_processors > 2 ? 1 : 0;
+	uint32_t max_possible_workers = runtime_total_online_processors - skipped_cores - 1;
 
 	/* Number of Workers */
 	char *worker_count_raw = getenv("SLEDGE_NWORKERS");
@@ -87,43 +102,99 @@ runtime_allocate_available_cores()
 		runtime_worker_threads_count = max_possible_workers;
 	}
 
-	printf("\tListener core ID: %u\n", LISTENER_THREAD_CORE_ID);
-	printf("\tFirst Worker core ID: %u\n", runtime_first_worker_processor);
+	runtime_worker_threads          = runtime_allocate_per_worker(sizeof(pthread_t));
+	runtime_worker_threads_argument = runtime_allocate_per_worker(sizeof(int));
+	runtime_worker_threads_core     = runtime_allocate_per_worker(sizeof(uint32_t));
+	runtime_worker_threads_deadline = runtime_allocate_per_worker(sizeof(struct runtime_worker_deadline));
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		runtime_worker_threads_deadline[i].deadline = UINT64_MAX;
+	}
+
+	/* Assign the available cores in ascending order: skipped, listener, then workers */
+	uint32_t assigned = 0;
+	for (uint32_t cpu = 0; cpu < CPU_SETSIZE && assigned < skipped_cores + 1 + runtime_worker_threads_count; cpu++) {
+		if (!CPU_ISSET(cpu, &available)) continue;
+
+		if (assigned == skipped_cores) {
+			listener_thread_core_id = cpu;
+		} else if (assigned > skipped_cores) {
+			runtime_worker_threads_core[assigned - skipped_cores - 1] = cpu;
+		}
+		assigned++;
+	}
+
+	printf("\tListener core ID: %u\n", listener_thread_core_id);
+	printf("\tFirst Worker core ID: %u\n", runtime_worker_threads_core[0]);
 	printf("\tWorker core count: %u\n", runtime_worker_threads_count);
 }
 
 /**
- * Returns the cpu MHz entry for CPU0 in /proc/cpuinfo, rounded to the nearest MHz
- * We are assuming all cores are the same clock speed, which is not true of many systems
- * We are also assuming this value is static
- * @return proceccor speed in MHz
+ * Reads CLOCK_MONOTONIC_RAW and __getcycles as close together as possible, keeping the closest of several attempts so
+ * that an interrupt between the reads does not skew the pair
+ * @param cycles set to the cycle count halfway through the read of the clock
+ * @returns the clock in nanoseconds
  */
-static inline uint32_t
-runtime_get_processor_speed_MHz(void)
+static uint64_t
+runtime_sample_clocks(uint64_t *cycles)
 {
-	uint32_t return_value;
+	uint64_t closest = UINT64_MAX;
+	uint64_t ns      = 0;
+
+	for (int i = 0; i < RUNTIME_CALIBRATION_SAMPLE_COUNT; i++) {
+		struct timespec now;
+		uint64_t        before = __getcycles();
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		uint64_t after = __getcycles();
+
+		if (after - before < closest) {
+			closest = after - before;
+			*cycles = before + (after - before) / 2;
+			ns      = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+		}
+	}
 
-	FILE *cmd = popen("grep '^cpu MHz' /proc/cpuinfo | head -n 1 | awk '{print $4}'", "r");
-	if (unlikely(cmd == NULL)) goto err;
+	return ns;
+}
 
-	char   buff[16];
-	size_t n = fread(buff, 1, sizeof(buff) - 1, cmd);
-	if (unlikely(n <= 0)) goto err;
-	buff[n] = '\0';
+/**
+ * Measures the frequency of __getcycles against CLOCK_MONOTONIC_RAW, which is not slewed by NTP
+ * @returns frequency in Hz
+ */
+static uint64_t
+runtime_calibrate_getcycles_Hz(void)
+{
+	uint64_t start_cycles, end_cycles;
+	uint64_t start_ns = runtime_sample_clocks(&start_cycles);
 
-	float processor_speed_MHz;
-	n = sscanf(buff, "%f", &processor_speed_MHz);
-	if (unlikely(n != 1)) goto err;
-	if (unlikely(processor_speed_MHz < 0)) goto err;
+	struct timespec interval = { .tv_sec = 0, .tv_nsec = RUNTIME_CALIBRATION_INTERVAL_NS };
+	while (nanosleep(&interval, &interval) < 0 && errno == EINTR)
+		;
 
-	return_value = (uint32_t)nearbyintf(processor_speed_MHz);
+	uint64_t end_ns = runtime_sample_clocks(&end_cycles);
+	if (unlikely(end_ns <= start_ns)) return 0;
 
-done:
-	pclose(cmd);
-	return return_value;
-err:
-	return_value = 0;
-	goto done;
+	return (end_cycles - start_cycles) * 1000000000 / (end_ns - start_ns);
+}
+
+/**
+ * Returns the frequency of __getcycles, rounded to the nearest MHz, which every conversion between cycles and time
+ * uses. This is a fixed rate rather than the current clock of a core, which changes with frequency scaling. The
+ * frequency reported by the hardware is used where available, and is otherwise measured at startup
+ * @return frequency in MHz, or 0 on error
+ */
+static inline uint32_t
+runtime_get_processor_speed_MHz(void)
+{
+	const char *source       = "hardware";
+	uint64_t    frequency_Hz = arch_getcycles_frequency_Hz();
+	if (frequency_Hz == 0) {
+		source       = "calibrated against CLOCK_MONOTONIC_RAW";
+		frequency_Hz = runtime_calibrate_getcycles_Hz();
+	}
+
+	uint32_t frequency_MHz = (uint32_t)((frequency_Hz + 500000) / 1000000);
+	printf("\tCycle Counter: %lu Hz, %s\n", frequency_Hz, source);
+	return frequency_MHz;
 }
 
 /**
@@ -167,13 +238,40 @@ runtime_start_runtime_worker_threads()
 
 		cpu_set_t cs;
 		CPU_ZERO(&cs);
-		CPU_SET(runtime_first_worker_processor + i, &cs);
+		CPU_SET(runtime_worker_threads_core[i], &cs);
 		ret = pthread_setaffinity_np(runtime_worker_threads[i], sizeof(cs), &cs);
 		assert(ret == 0);
 	}
 	debuglog("Sandboxing environment ready!\n");
 }
 
+/**
+ * Orders the cores assigned to worker threads by NUMA node, so that the workers of a node have consecutive indices
+ */
+void
+runtime_place_worker_threads()
+{
+	if (!runtime_numa_enabled) return;
+
+	int nodes[runtime_worker_threads_count];
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		nodes[i] = numa_topology_get_node_of_cpu(runtime_worker_threads_core[i]);
+	}
+
+	/* Stable insertion sort by node, which keeps cores of a node in ascending order */
+	for (int i = 1; i < runtime_worker_threads_count; i++) {
+		uint32_t core = runtime_worker_threads_core[i];
+		int      node = nodes[i];
+		int      j    = i - 1;
+		for (; j >= 0 && nodes[j] > node; j--) {
+			runtime_worker_threads_core[j + 1] = runtime_worker_threads_core[j];
+			nodes[j + 1]                       = nodes[j];
+		}
+		runtime_worker_threads_core[j + 1] = core;
+		nodes[j + 1]                       = node;
+	}
+}
+
 void
 runtime_configure()
 {
@@ -184,8 +282,12 @@ runtime_configure()
 		scheduler = SCHEDULER_EDF;
 	} else if (strcmp(scheduler_policy, "FIFO") == 0) {
 		scheduler = SCHEDULER_FIFO;
+	} else if (strcmp(scheduler_policy, "LLF") == 0) {
+		scheduler = SCHEDULER_LLF;
+	} else if (strcmp(scheduler_policy, "SRPT") == 0) {
+		scheduler = SCHEDULER_SRPT;
 	} else {
-		panic("Invalid scheduler policy: %s. Must be {EDF|FIFO}\n", scheduler_policy);
+		panic("Invalid scheduler policy: %s. Must be {EDF|FIFO|LLF|SRPT}\n", scheduler_policy);
 	}
 	printf("\tScheduler Policy: %s\n", scheduler_print(scheduler));
 
@@ -202,6 +304,21 @@ runtime_configure()
 	}
 	printf("\tSigalrm Policy: %s\n", runtime_print_sigalrm_handler(runtime_sigalrm_handler));
 
+	/* NUMA */
+	char *numa = getenv("SLEDGE_NUMA");
+	if (numa != NULL && strcmp(numa, "false") != 0) runtime_numa_enabled = true;
+	printf("\tNUMA: %s\n", runtime_numa_enabled ? "Enabled" : "Disabled");
+	runtime_place_worker_threads();
+
+	/* Worker Pools */
+	worker_pools_initialize(getenv("SLEDGE_WORKER_POOLS"));
+	for (uint32_t i = 0; i < worker_pools_count; i++) {
+		if (unlikely(runtime_sigalrm_handler == RUNTIME_SIGALRM_HANDLER_TRIAGED
+		             && worker_pools[i].scheduler != SCHEDULER_EDF))
+			panic("triaged sigalrm handlers are only valid if all worker pools use EDF\n");
+	}
+	worker_pools_print();
+
 	/* Runtime Preemption Toggle */
 	char *preempt_disable = getenv("SLEDGE_DISABLE_PREEMPTION");
 	if (preempt_disable != NULL && strcmp(preempt_disable, "false") != 0) runtime_preemption_enabled = false;
@@ -218,17 +335,130 @@ runtime_configure()
 	}
 	printf("\tQuantum: %u us\n", runtime_quantum_us);
 
+	/* Worker Idle Loop */
+	char *idle_sleep_disable = getenv("SLEDGE_DISABLE_WORKER_IDLE_SLEEP");
+	if (idle_sleep_disable != NULL && strcmp(idle_sleep_disable, "false") != 0)
+		runtime_worker_idle_sleep_enabled = false;
+
+	char *idle_spin_raw = getenv("SLEDGE_WORKER_IDLE_SPIN_US");
+	if (idle_spin_raw != NULL) {
+		long idle_spin = atol(idle_spin_raw);
+		if (unlikely(idle_spin < 0))
+			panic("SLEDGE_WORKER_IDLE_SPIN_US must be a non-negative integer, saw %ld\n", idle_spin);
+		if (unlikely(idle_spin > 999999))
+			panic("SLEDGE_WORKER_IDLE_SPIN_US must be less than 999999 us, saw %ld\n", idle_spin);
+		runtime_worker_idle_spin_us = (uint32_t)idle_spin;
+	}
+	if (runtime_worker_idle_sleep_enabled) {
+		printf("\tWorker Idle Sleep: After spinning %u us\n", runtime_worker_idle_spin_us);
+	} else {
+		printf("\tWorker Idle Sleep: Disabled\n");
+	}
+
+	/* Early Drop of Infeasible Requests */
+	char *early_drop = getenv("SLEDGE_EARLY_DROP");
+	if (early_drop != NULL && strcmp(early_drop, "false") != 0) runtime_early_drop_enabled = true;
+	printf("\tEarly Drop: %s\n", runtime_early_drop_enabled ? "Enabled" : "Disabled");
+
+	char *early_drop_sweep_raw = getenv("SLEDGE_EARLY_DROP_SWEEP_US");
+	if (early_drop_sweep_raw != NULL) {
+		long sweep_period = atol(early_drop_sweep_raw);
+		if (unlikely(sweep_period < 0))
+			panic("SLEDGE_EARLY_DROP_SWEEP_US must be a non-negative integer, saw %ld\n", sweep_period);
+		if (unlikely(!runtime_early_drop_enabled && sweep_period > 0))
+			panic("SLEDGE_EARLY_DROP_SWEEP_US requires SLEDGE_EARLY_DROP\n");
+		if (unlikely(sweep_period > 0 && scheduler == SCHEDULER_FIFO))
+			panic("SLEDGE_EARLY_DROP_SWEEP_US is only valid with minheap schedulers\n");
+		runtime_early_drop_sweep_period_us = (uint32_t)sweep_period;
+	}
+	if (runtime_early_drop_sweep_period_us > 0) {
+		printf("\tEarly Drop Sweep: %u us\n", runtime_early_drop_sweep_period_us);
+	} else {
+		printf("\tEarly Drop Sweep: Disabled\n");
+	}
+
+	/* Admissions Control Feedback */
+	char *admissions_control_feedback = getenv("SLEDGE_ADMISSIONS_CONTROL_FEEDBACK");
+	if (admissions_control_feedback != NULL && strcmp(admissions_control_feedback, "false") != 0) {
+#ifdef ADMISSIONS_CONTROL
+		admissions_control_feedback_enabled = true;
+#else
+		panic("SLEDGE_ADMISSIONS_CONTROL_FEEDBACK requires the runtime to be built with ADMISSIONS_CONTROL\n");
+#endif
+	}
+	printf("\tAdmissions Control Feedback: %s\n", admissions_control_feedback_enabled ? "Enabled" : "Disabled");
+
+	/* Per-Request Deadlines */
+	char *deadline_header = getenv("SLEDGE_DEADLINE_HEADER");
+	if (deadline_header != NULL && strcmp(deadline_header, "false") != 0) {
+		if (unlikely(scheduler == SCHEDULER_FIFO))
+			panic("SLEDGE_DEADLINE_HEADER is only valid with deadline-aware schedulers\n");
+		runtime_deadline_header_enabled = true;
+	}
+	printf("\tDeadline Header: %s\n", runtime_deadline_header_enabled ? "Enabled" : "Disabled");
+
+	/* Size-Aware Execution Estimates */
+	char *admissions_size_aware = getenv("SLEDGE_ADMISSIONS_SIZE_AWARE");
+	if (admissions_size_aware != NULL && strcmp(admissions_size_aware, "false") != 0) {
+#ifdef ADMISSIONS_CONTROL
+		admissions_info_size_aware_enabled = true;
+#else
+		panic("SLEDGE_ADMISSIONS_SIZE_AWARE requires the runtime to be built with ADMISSIONS_CONTROL\n");
+#endif
+	}
+	printf("\tSize-Aware Estimates: %s\n", admissions_info_size_aware_enabled ? "Enabled" : "Disabled");
+
+	/* Hardware Performance Counters */
+	char *perf_counters = getenv("SLEDGE_PERF_COUNTERS");
+	if (perf_counters != NULL && strcmp(perf_counters, "false") != 0) perf_counters_enabled = true;
+	printf("\tPerf Counters: %s\n", perf_counters_enabled ? "Enabled" : "Disabled");
+
+	/* Lock Contention Profile */
+	char *lock_profile = getenv("SLEDGE_LOCK_PROFILE");
+	if (lock_profile != NULL && strcmp(lock_profile, "false") != 0) lock_profile_enabled = true;
+	printf("\tLock Profile: %s\n", lock_profile_enabled ? "Enabled" : "Disabled");
+
+	/* Metrics Server */
+	char *metrics_port_raw = getenv("SLEDGE_METRICS_PORT");
+	if (metrics_port_raw != NULL) {
+		long metrics_port = atol(metrics_port_raw);
+		if (unlikely(metrics_port <= 0 || metrics_port > 65535))
+			panic("SLEDGE_METRICS_PORT must be a valid port, saw %s\n", metrics_port_raw);
+		metrics_server_port = (int)metrics_port;
+		printf("\tMetrics Port: %d\n", metrics_server_port);
+	} else {
+		printf("\tMetrics Port: Disabled\n");
+	}
+
 	/* Runtime Perf Log */
 	char *runtime_sandbox_perf_log_path = getenv("SLEDGE_SANDBOX_PERF_LOG");
 	if (runtime_sandbox_perf_log_path != NULL) {
 		printf("\tSandbox Performance Log: %s\n", runtime_sandbox_perf_log_path);
-		runtime_sandbox_perf_log = fopen(runtime_sandbox_perf_log_path, "w");
-		if (runtime_sandbox_perf_log == NULL) { perror("sandbox perf log"); }
-		fprintf(runtime_sandbox_perf_log, "id,function,state,deadline,actual,queued,initializing,runnable,"
-		                                  "running,blocked,returned,memory\n");
+		sandbox_perf_log_initialize(runtime_sandbox_perf_log_path);
 	} else {
 		printf("\tSandbox Performance Log: Disabled\n");
 	}
+
+	/* Sandbox Trace */
+	char *sandbox_trace_path = getenv("SLEDGE_SANDBOX_TRACE");
+	if (sandbox_trace_path != NULL) {
+#ifdef LOG_SANDBOX_TRACE
+		uint64_t capacity     = SANDBOX_TRACE_DEFAULT_RING_CAPACITY;
+		char *   capacity_raw = getenv("SLEDGE_SANDBOX_TRACE_EVENTS");
+		if (capacity_raw != NULL) {
+			long events = atol(capacity_raw);
+			if (unlikely(events <= 0))
+				panic("SLEDGE_SANDBOX_TRACE_EVENTS must be a positive integer, saw %ld\n", events);
+			capacity = (uint64_t)events;
+		}
+		sandbox_trace_initialize(sandbox_trace_path, capacity);
+		printf("\tSandbox Trace: %s (%lu events per worker)\n", sandbox_trace_path, sandbox_trace_ring_capacity);
+#else
+		panic("SLEDGE_SANDBOX_TRACE requires the runtime to be built with LOG_SANDBOX_TRACE\n");
+#endif
+	} else {
+		printf("\tSandbox Trace: Disabled\n");
+	}
 }
 
 void
@@ -259,8 +489,6 @@ log_compiletime_config()
 	printf("\tArchitecture: %s\n", "x86_64");
 #endif
 
-	int ncores = NCORES;
-	printf("\tTotal Cores: %d\n", ncores);
 	int page_size = PAGE_SIZE;
 	printf("\tPage Size: %d\n", page_size);
 
@@ -312,16 +540,10 @@ log_compiletime_config()
 	printf("\tLog Module Loading: Disabled\n");
 #endif
 
-#ifdef LOG_TOTAL_REQS_RESPS
-	printf("\tLog Total Reqs/Resps: Enabled\n");
+#ifdef LOG_SANDBOX_TRACE
+	printf("\tLog Sandbox Trace: Enabled\n");
 #else
-	printf("\tLog Total Reqs/Resps: Disabled\n");
-#endif
-
-#ifdef LOG_SANDBOX_COUNT
-	printf("\tLog Sandbox Count: Enabled\n");
-#else
-	printf("\tLog Sandbox Count: Disabled\n");
+	printf("\tLog Sandbox Trace: Disabled\n");
 #endif
 
 #ifdef LOG_LOCAL_RUNQUEUE
@@ -346,10 +568,8 @@ main(int argc, char **argv)
 
 	printf("Runtime Environment:\n");
 
-	memset(runtime_worker_threads, 0, sizeof(pthread_t) * RUNTIME_WORKER_THREAD_CORE_COUNT);
-
 	runtime_processor_speed_MHz = runtime_get_processor_speed_MHz();
-	if (unlikely(runtime_processor_speed_MHz == 0)) panic("Failed to detect processor speed\n");
+	if (unlikely(runtime_processor_speed_MHz == 0)) panic("Failed to detect the frequency of the cycle counter\n");
 
 	software_interrupt_set_interval_duration(runtime_quantum_us * runtime_processor_speed_MHz);
 
@@ -370,6 +590,9 @@ main(int argc, char **argv)
 #endif
 	if (module_new_from_json(argv[1])) panic("failed to initialize module(s) defined in %s\n", argv[1]);
 
+	/* Modules must be loaded first, as the metrics server reads the module database without a lock */
+	metrics_server_initialize();
+
 
 	for (int i = 0; i < runtime_worker_threads_count; i++) {
 		int ret = pthread_join(runtime_worker_threads[i], NULL);
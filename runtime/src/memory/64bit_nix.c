@@ -1,5 +1,6 @@
 #ifdef USE_MEM_VM
 
+#include "arch/getcycles.h"
 #include "current_sandbox.h"
 #include "panic.h"
 #include "runtime.h"
@@ -12,6 +13,7 @@ void
 expand_memory(void)
 {
 	struct sandbox *sandbox = current_sandbox_get();
+	uint64_t        start   = __getcycles();
 
 	// FIXME: max_pages = 0 => no limit. Issue #103.
 	assert((sandbox->sandbox_size + local_sandbox_context_cache.linear_memory_size) / WASM_PAGE_SIZE
@@ -32,16 +34,11 @@ expand_memory(void)
 
 	local_sandbox_context_cache.linear_memory_size += WASM_PAGE_SIZE;
 
-#ifdef LOG_SANDBOX_MEMORY_PROFILE
-	// Cache the runtime of the first N page allocations
-	if (likely(sandbox->page_allocation_timestamps_size < SANDBOX_PAGE_ALLOCATION_TIMESTAMP_COUNT)) {
-		sandbox->page_allocation_timestamps[sandbox->page_allocation_timestamps_size++] =
-		  sandbox->running_duration + (uint32_t)(__getcycles() - sandbox->last_state_change_timestamp);
-	}
-#endif
-
 	// local_sandbox_context_cache is "forked state", so update authoritative member
 	sandbox->linear_memory_size = local_sandbox_context_cache.linear_memory_size;
+
+	sandbox->linear_memory_growth_count++;
+	sandbox->linear_memory_growth_duration += __getcycles() - start;
 }
 
 INLINE char *
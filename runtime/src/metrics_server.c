@@ -0,0 +1,451 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "debuglog.h"
+#include "http_total.h"
+#include "listener_thread.h"
+#include "lock_profile.h"
+#include "metrics_server.h"
+#include "module_database.h"
+#include "module_latency.h"
+#include "module_memory_profile.h"
+#include "module_slo.h"
+#include "panic.h"
+#include "perf_counters.h"
+#include "sandbox_state.h"
+
+/* Admin port that serves metrics in the Prometheus text format. 0 if disabled */
+int metrics_server_port = 0;
+
+static int       metrics_server_socket_descriptor = -1;
+static pthread_t metrics_server_thread;
+
+static const double metrics_server_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+/**
+ * Writes a Prometheus label value, escaping the characters the text format requires
+ * @param output
+ * @param value
+ */
+static void
+metrics_server_write_label_value(FILE *output, const char *value)
+{
+	for (; *value != '\0'; value++) {
+		switch (*value) {
+		case '\\':
+			fputs("\\\\", output);
+			break;
+		case '"':
+			fputs("\\\"", output);
+			break;
+		case '\n':
+			fputs("\\n", output);
+			break;
+		default:
+			fputc(*value, output);
+		}
+	}
+}
+
+/**
+ * Writes the request and response counters
+ * @param output
+ */
+static void
+metrics_server_write_http_totals(FILE *output)
+{
+	struct http_total total;
+	http_total_sum(&total);
+
+	fprintf(output, "# HELP sledge_http_requests_total Requests accepted by the listener\n");
+	fprintf(output, "# TYPE sledge_http_requests_total counter\n");
+	fprintf(output, "sledge_http_requests_total %ld\n", total.requests);
+
+	fprintf(output, "# HELP sledge_http_responses_total Responses by status class\n");
+	fprintf(output, "# TYPE sledge_http_responses_total counter\n");
+	fprintf(output, "sledge_http_responses_total{code=\"2XX\"} %ld\n", total.responses_2XX);
+	fprintf(output, "sledge_http_responses_total{code=\"4XX\"} %ld\n", total.responses_4XX);
+	fprintf(output, "sledge_http_responses_total{code=\"5XX\"} %ld\n", total.responses_5XX);
+
+	fprintf(output, "# HELP sledge_http_header_peeks_total Header peeks by the listener by outcome. Requests whose "
+	                "peek timed out use the defaults of their module\n");
+	fprintf(output, "# TYPE sledge_http_header_peeks_total counter\n");
+	for (int i = 0; i < LISTENER_THREAD_PEEK_OUTCOME_COUNT; i++) {
+		fprintf(output, "sledge_http_header_peeks_total{outcome=\"%s\"} %lu\n",
+		        listener_thread_peek_outcome_labels[i],
+		        atomic_load_explicit(&listener_thread_peek_outcomes[i], memory_order_relaxed));
+	}
+}
+
+/**
+ * Writes the number of sandboxes in each state
+ * @param output
+ */
+static void
+metrics_server_write_sandbox_states(FILE *output)
+{
+	fprintf(output, "# HELP sledge_sandboxes Sandboxes in each state\n");
+	fprintf(output, "# TYPE sledge_sandboxes gauge\n");
+	for (int i = 0; i < SANDBOX_STATE_COUNT; i++) {
+		if (!sandbox_state_is_terminal[i]) continue;
+		fprintf(output, "sledge_sandboxes{state=\"%s\"} %ld\n", sandbox_state_stringify(i),
+		        sandbox_state_count_sum(i));
+	}
+}
+
+/**
+ * Writes the request outcomes and the deadline miss ratio of each module
+ * @param output
+ */
+static void
+metrics_server_write_module_slos(FILE *output)
+{
+	uint64_t totals[module_database_count][MODULE_SLO_OUTCOME_COUNT];
+	for (size_t i = 0; i < module_database_count; i++) module_slo_sum(&module_database[i]->slo, totals[i]);
+
+	fprintf(output, "# HELP sledge_module_requests_total Requests by outcome\n");
+	fprintf(output, "# TYPE sledge_module_requests_total counter\n");
+	for (size_t i = 0; i < module_database_count; i++) {
+		for (int j = 0; j < MODULE_SLO_OUTCOME_COUNT; j++) {
+			fprintf(output, "sledge_module_requests_total{module=\"");
+			metrics_server_write_label_value(output, module_database[i]->name);
+			fprintf(output, "\",outcome=\"%s\"} %lu\n", module_slo_outcome_labels[j], totals[i][j]);
+		}
+	}
+
+	fprintf(output, "# HELP sledge_module_deadline_miss_ratio Completions after the deadline over the SLO window\n");
+	fprintf(output, "# TYPE sledge_module_deadline_miss_ratio gauge\n");
+	for (size_t i = 0; i < module_database_count; i++) {
+		fprintf(output, "sledge_module_deadline_miss_ratio{module=\"");
+		metrics_server_write_label_value(output, module_database[i]->name);
+		fprintf(output, "\"} %g\n",
+		        (double)atomic_load_explicit(&module_database[i]->slo.miss_permille, memory_order_relaxed)
+		          / MODULE_SLO_MISS_PERMILLE_MAX);
+	}
+}
+
+/**
+ * Writes the quantiles, sum and count of a histogram as the summary of a module
+ * @param output
+ * @param name of the metric
+ * @param module
+ * @param histogram private histogram
+ */
+static void
+metrics_server_write_module_summary(FILE *output, const char *name, struct module *module,
+                                    struct latency_histogram *histogram)
+{
+	uint64_t count = latency_histogram_get_count(histogram);
+
+	for (size_t k = 0; k < sizeof(metrics_server_quantiles) / sizeof(metrics_server_quantiles[0]); k++) {
+		fprintf(output, "%s{module=\"", name);
+		metrics_server_write_label_value(output, module->name);
+		fprintf(output, "\",quantile=\"%g\"} %u\n", metrics_server_quantiles[k],
+		        latency_histogram_get_quantile(histogram, count, metrics_server_quantiles[k]));
+	}
+
+	fprintf(output, "%s_sum{module=\"", name);
+	metrics_server_write_label_value(output, module->name);
+	fprintf(output, "\"} %lu\n", (uint64_t)histogram->sum);
+
+	fprintf(output, "%s_count{module=\"", name);
+	metrics_server_write_label_value(output, module->name);
+	fprintf(output, "\"} %lu\n", count);
+}
+
+/**
+ * Writes a summary of each latency metric of each module, merging the histograms of all workers
+ * @param output
+ */
+static void
+metrics_server_write_module_latencies(FILE *output)
+{
+	struct latency_histogram *merged = malloc(module_database_count * MODULE_LATENCY_METRIC_COUNT
+	                                          * sizeof(struct latency_histogram));
+	if (merged == NULL) {
+		debuglog("Failed to allocate histograms: %s\n", strerror(errno));
+		return;
+	}
+
+	for (size_t i = 0; i < module_database_count; i++) {
+		module_latency_merge(&module_database[i]->latency, &merged[i * MODULE_LATENCY_METRIC_COUNT]);
+	}
+
+	for (int j = 0; j < MODULE_LATENCY_METRIC_COUNT; j++) {
+		char name[64];
+		snprintf(name, sizeof(name), "sledge_sandbox_%s_microseconds", module_latency_metric_labels[j]);
+		fprintf(output, "# HELP %s Latency of completed sandboxes\n", name);
+		fprintf(output, "# TYPE %s summary\n", name);
+
+		for (size_t i = 0; i < module_database_count; i++) {
+			metrics_server_write_module_summary(output, name, module_database[i],
+			                                    &merged[i * MODULE_LATENCY_METRIC_COUNT + j]);
+		}
+	}
+
+	free(merged);
+}
+
+/**
+ * Writes a summary of each memory metric of each module, merging the histograms of all workers
+ * @param output
+ */
+static void
+metrics_server_write_module_memory_profiles(FILE *output)
+{
+	static const char *help[MODULE_MEMORY_PROFILE_METRIC_COUNT] = {
+		[MODULE_MEMORY_PROFILE_PAGES]           = "Linear memory pages of completed sandboxes at their peak",
+		[MODULE_MEMORY_PROFILE_GROWTH_PAGES]    = "Linear memory pages added while running completed sandboxes",
+		[MODULE_MEMORY_PROFILE_GROWTH_DURATION] = "Time spent adding linear memory pages to completed sandboxes",
+	};
+
+	struct latency_histogram *merged = malloc(module_database_count * MODULE_MEMORY_PROFILE_METRIC_COUNT
+	                                          * sizeof(struct latency_histogram));
+	if (merged == NULL) {
+		debuglog("Failed to allocate histograms: %s\n", strerror(errno));
+		return;
+	}
+
+	for (size_t i = 0; i < module_database_count; i++) {
+		module_memory_profile_merge(&module_database[i]->memory_profile,
+		                            &merged[i * MODULE_MEMORY_PROFILE_METRIC_COUNT]);
+	}
+
+	for (int j = 0; j < MODULE_MEMORY_PROFILE_METRIC_COUNT; j++) {
+		char name[64];
+		snprintf(name, sizeof(name), "sledge_sandbox_%s", module_memory_profile_metric_labels[j]);
+		fprintf(output, "# HELP %s %s\n", name, help[j]);
+		fprintf(output, "# TYPE %s summary\n", name);
+
+		for (size_t i = 0; i < module_database_count; i++) {
+			metrics_server_write_module_summary(output, name, module_database[i],
+			                                    &merged[i * MODULE_MEMORY_PROFILE_METRIC_COUNT + j]);
+		}
+	}
+
+	free(merged);
+}
+
+/**
+ * Writes the hardware events counted while running the completed sandboxes of each module
+ * Events that some worker could not count are written as NaN
+ * @param output
+ */
+static void
+metrics_server_write_module_perf_counters(FILE *output)
+{
+	if (!perf_counters_enabled) return;
+
+	uint64_t sums[module_database_count][PERF_COUNTERS_EVENT_COUNT];
+	for (size_t i = 0; i < module_database_count; i++) {
+		perf_counters_module_sum(module_database[i]->perf_counters, sums[i]);
+	}
+
+	for (int j = 0; j < PERF_COUNTERS_EVENT_COUNT; j++) {
+		const char *event = perf_counters_event_labels[j];
+		fprintf(output, "# HELP sledge_sandbox_%s_total Hardware events while running completed sandboxes\n",
+		        event);
+		fprintf(output, "# TYPE sledge_sandbox_%s_total counter\n", event);
+
+		for (size_t i = 0; i < module_database_count; i++) {
+			fprintf(output, "sledge_sandbox_%s_total{module=\"", event);
+			metrics_server_write_label_value(output, module_database[i]->name);
+			if (sums[i][j] == PERF_COUNTERS_UNAVAILABLE) {
+				fprintf(output, "\"} NaN\n");
+			} else {
+				fprintf(output, "\"} %lu\n", sums[i][j]);
+			}
+		}
+	}
+}
+
+/**
+ * Writes a summary of the waits for a lock in nanoseconds
+ * @param profile
+ * @param merged wait histogram in cycles
+ * @param argument the output
+ */
+static void
+metrics_server_write_lock_profile(struct lock_profile *profile, struct latency_histogram *merged, void *argument)
+{
+	FILE *   output = argument;
+	uint64_t count  = latency_histogram_get_count(merged);
+
+	for (size_t k = 0; k < sizeof(metrics_server_quantiles) / sizeof(metrics_server_quantiles[0]); k++) {
+		uint64_t wait = latency_histogram_get_quantile(merged, count, metrics_server_quantiles[k]);
+		fprintf(output, "sledge_lock_wait_nanoseconds{lock=\"%s\",instance=\"", profile->site);
+		metrics_server_write_label_value(output, profile->instance);
+		fprintf(output, "\",quantile=\"%g\"} %lu\n", metrics_server_quantiles[k],
+		        wait * 1000 / runtime_processor_speed_MHz);
+	}
+
+	fprintf(output, "sledge_lock_wait_nanoseconds_sum{lock=\"%s\",instance=\"", profile->site);
+	metrics_server_write_label_value(output, profile->instance);
+	fprintf(output, "\"} %lu\n", (uint64_t)merged->sum * 1000 / runtime_processor_speed_MHz);
+
+	fprintf(output, "sledge_lock_wait_nanoseconds_count{lock=\"%s\",instance=\"", profile->site);
+	metrics_server_write_label_value(output, profile->instance);
+	fprintf(output, "\"} %lu\n", count);
+}
+
+/**
+ * Writes the contention of each profiled lock
+ * @param output
+ */
+static void
+metrics_server_write_lock_profiles(FILE *output)
+{
+	if (!lock_profile_enabled) return;
+
+	fprintf(output, "# HELP sledge_lock_wait_nanoseconds Time spent waiting to acquire a lock\n");
+	fprintf(output, "# TYPE sledge_lock_wait_nanoseconds summary\n");
+	lock_profile_visit(metrics_server_write_lock_profile, output);
+}
+
+/**
+ * Sends a buffer to a client, retrying partial sends
+ * @param client_socket
+ * @param buffer
+ * @param length in bytes
+ */
+static void
+metrics_server_send(int client_socket, const char *buffer, size_t length)
+{
+	while (length > 0) {
+		ssize_t sent = send(client_socket, buffer, length, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) continue;
+			debuglog("Failed to send metrics: %s\n", strerror(errno));
+			return;
+		}
+		buffer += sent;
+		length -= sent;
+	}
+}
+
+/**
+ * Reads the request line of a client and responds with the metrics, or with 404 for paths other than / and /metrics
+ * @param client_socket
+ */
+static void
+metrics_server_handle(int client_socket)
+{
+	char    request[METRICS_SERVER_REQUEST_BUFFER_SIZE];
+	ssize_t length = 0;
+
+	/* Only the request line is needed, so stop reading once it has arrived */
+	while (length < (ssize_t)sizeof(request) - 1) {
+		ssize_t received = recv(client_socket, request + length, sizeof(request) - 1 - length, 0);
+		if (received < 0 && errno == EINTR) continue;
+		if (received <= 0) break;
+		length += received;
+		request[length] = '\0';
+		if (strstr(request, "\r\n") != NULL) break;
+	}
+	request[length] = '\0';
+
+	if (strncmp(request, "GET /metrics ", 13) != 0 && strncmp(request, "GET / ", 6) != 0) {
+		static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+		                                "Connection: close\r\n\r\n";
+		metrics_server_send(client_socket, not_found, sizeof(not_found) - 1);
+		return;
+	}
+
+	char * body        = NULL;
+	size_t body_length = 0;
+	FILE * output      = open_memstream(&body, &body_length);
+	if (output == NULL) {
+		debuglog("Failed to open metrics buffer: %s\n", strerror(errno));
+		return;
+	}
+
+	metrics_server_write_http_totals(output);
+	metrics_server_write_sandbox_states(output);
+	metrics_server_write_module_slos(output);
+	metrics_server_write_module_latencies(output);
+	metrics_server_write_module_memory_profiles(output);
+	metrics_server_write_module_perf_counters(output);
+	metrics_server_write_lock_profiles(output);
+	fclose(output);
+
+	char header[128];
+	int  header_length = snprintf(header, sizeof(header),
+	                              "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+	                              "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+	                              body_length);
+	metrics_server_send(client_socket, header, header_length);
+	metrics_server_send(client_socket, body, body_length);
+	free(body);
+}
+
+/**
+ * The metrics server thread. Serves one scrape at a time, as scrapes are infrequent
+ */
+static void *
+metrics_server_main(void *argument)
+{
+	while (true) {
+		int client_socket = accept(metrics_server_socket_descriptor, NULL, NULL);
+		if (client_socket < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			panic("accept: %s", strerror(errno));
+		}
+
+		/* A slow client must not stall later scrapes */
+		struct timeval timeout = { .tv_sec  = METRICS_SERVER_SOCKET_TIMEOUT_MS / 1000,
+			                   .tv_usec = (METRICS_SERVER_SOCKET_TIMEOUT_MS % 1000) * 1000 };
+		setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		metrics_server_handle(client_socket);
+		close(client_socket);
+	}
+
+	return NULL;
+}
+
+/**
+ * Listens on metrics_server_port and starts the metrics server thread on the core of the listener thread, so that
+ * scrapes do not take time from workers. Call after modules are loaded
+ */
+void
+metrics_server_initialize(void)
+{
+	if (!metrics_server_is_enabled()) return;
+
+	metrics_server_socket_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+	if (unlikely(metrics_server_socket_descriptor < 0)) panic_err();
+
+	int optval = 1;
+	if (unlikely(setsockopt(metrics_server_socket_descriptor, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval))
+	             < 0))
+		panic_err();
+
+	struct sockaddr_in address = { .sin_family      = AF_INET,
+		                       .sin_addr.s_addr = htonl(INADDR_ANY),
+		                       .sin_port        = htons((unsigned short)metrics_server_port) };
+	if (unlikely(bind(metrics_server_socket_descriptor, (struct sockaddr *)&address, sizeof(address)) < 0))
+		panic("Failed to bind metrics port %d: %s\n", metrics_server_port, strerror(errno));
+	if (unlikely(listen(metrics_server_socket_descriptor, MODULE_MAX_PENDING_CLIENT_REQUESTS) < 0)) panic_err();
+
+	int rc = pthread_create(&metrics_server_thread, NULL, metrics_server_main, NULL);
+	if (rc != 0) {
+		errno = rc;
+		panic_err();
+	}
+
+	cpu_set_t cs;
+	CPU_ZERO(&cs);
+	CPU_SET(listener_thread_core_id, &cs);
+	rc = pthread_setaffinity_np(metrics_server_thread, sizeof(cpu_set_t), &cs);
+	assert(rc == 0);
+
+	printf("Serving metrics on port %d\n", metrics_server_port);
+}
@@ -11,6 +11,7 @@
 #include "http.h"
 #include "likely.h"
 #include "listener_thread.h"
+#include "lock_profile.h"
 #include "module.h"
 #include "module_database.h"
 #include "panic.h"
@@ -135,6 +136,13 @@ module_free(struct module *module)
 
 	close(module->socket_descriptor);
 	dlclose(module->dynamic_library_handle);
+	lock_profile_unregister(&module->concurrency.lock.profile);
+	module_concurrency_deinitialize(&module->concurrency);
+	admissions_info_deinitialize(&module->admissions_info);
+	module_latency_deinitialize(&module->latency);
+	module_memory_profile_deinitialize(&module->memory_profile);
+	module_slo_deinitialize(&module->slo);
+	free(module->perf_counters);
 	free(module);
 }
 
@@ -152,18 +160,28 @@ module_free(struct module *module)
  * @param relative_deadline_us
  * @param port
  * @param request_size
+ * @param reservation_budget_us CPU budget reserved per period. 0 if the module has no reservation
+ * @param reservation_period_us
+ * @param max_concurrency maximum requests executing or in the global request scheduler. 0 if unlimited
+ * @param max_queued maximum requests waiting for a concurrency slot
+ * @param pool_idx index of the worker pool that executes the module
+ * @param slo_miss_permille deadline misses per thousand completions above which an event is logged. 0 disables
  * @returns A new module or NULL in case of failure
  */
 
 struct module *
 module_new(char *name, char *path, int32_t argument_count, uint32_t stack_size, uint32_t max_memory,
            uint32_t relative_deadline_us, int port, int request_size, int response_size, int admissions_percentile,
-           uint32_t expected_execution_us)
+           uint32_t expected_execution_us, uint32_t reservation_budget_us, uint32_t reservation_period_us,
+           uint32_t max_concurrency, uint32_t max_queued, uint32_t pool_idx, uint32_t slo_miss_permille)
 {
 	int rc = 0;
 
+	/* aligned_alloc requires the size to be a multiple of the alignment */
+	size_t size = (sizeof(struct module) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
 	errno                 = 0;
-	struct module *module = (struct module *)malloc(sizeof(struct module));
+	struct module *module = (struct module *)aligned_alloc(CACHE_LINE_SIZE, size);
 	if (!module) {
 		fprintf(stderr, "Failed to allocate module: %s\n", strerror(errno));
 		goto err;
@@ -228,6 +246,7 @@ module_new(char *name, char *path, int32_t argument_count, uint32_t stack_size,
 	module->max_memory        = max_memory == 0 ? ((uint64_t)WASM_PAGE_SIZE * WASM_MAX_PAGES) : max_memory;
 	module->socket_descriptor = -1;
 	module->port              = port;
+	module->pool_idx          = pool_idx;
 
 	/* Deadlines */
 	module->relative_deadline_us = relative_deadline_us;
@@ -243,6 +262,29 @@ module_new(char *name, char *path, int32_t argument_count, uint32_t stack_size,
 	admissions_info_initialize(&module->admissions_info, admissions_percentile, expected_execution,
 	                           module->relative_deadline);
 
+	/* Bandwidth Reservation */
+	module_reservation_initialize(&module->reservation,
+	                              (uint64_t)reservation_budget_us * runtime_processor_speed_MHz,
+	                              (uint64_t)reservation_period_us * runtime_processor_speed_MHz);
+
+	/* SLO Accounting */
+	module_slo_initialize(&module->slo, slo_miss_permille);
+
+	/* Latency and Memory Histograms and Hardware Counters */
+	module_latency_initialize(&module->latency);
+	module_memory_profile_initialize(&module->memory_profile);
+	perf_counters_module_initialize(&module->perf_counters);
+
+	/* Concurrency Limits */
+	rc = module_concurrency_initialize(&module->concurrency, max_concurrency, max_queued);
+	if (rc < 0) {
+		fprintf(stderr, "Failed to allocate concurrency queue of %s\n", name);
+		goto err_concurrency;
+	}
+
+	/* Lock Contention Profiles */
+	lock_profile_register(&module->concurrency.lock.profile, "module_concurrency", module->name);
+
 	/* Request Response Buffer */
 	if (request_size == 0) request_size = MODULE_DEFAULT_REQUEST_RESPONSE_SIZE;
 	if (response_size == 0) response_size = MODULE_DEFAULT_REQUEST_RESPONSE_SIZE;
@@ -280,6 +322,14 @@ done:
 	return module;
 
 err_listen:
+	lock_profile_unregister(&module->concurrency.lock.profile);
+	module_concurrency_deinitialize(&module->concurrency);
+err_concurrency:
+	free(module->perf_counters);
+	module_memory_profile_deinitialize(&module->memory_profile);
+	module_latency_deinitialize(&module->latency);
+	module_slo_deinitialize(&module->slo);
+	admissions_info_deinitialize(&module->admissions_info);
 dl_error:
 	dlclose(module->dynamic_library_handle);
 dl_open_error:
@@ -402,6 +452,12 @@ module_new_from_json(char *file_name)
 		uint32_t port                                                = 0;
 		uint32_t relative_deadline_us                                = 0;
 		uint32_t expected_execution_us                               = 0;
+		uint32_t reservation_budget_us                               = 0;
+		uint32_t reservation_period_us                               = 0;
+		uint32_t max_concurrency                                     = 0;
+		uint32_t max_queued                                          = 0;
+		uint32_t pool_idx                                            = 0;
+		uint32_t slo_miss_permille                                   = 0;
 		int      admissions_percentile                               = 50;
 		bool     is_active                                           = false;
 		int32_t  request_count                                       = 0;
@@ -464,6 +520,40 @@ module_new_from_json(char *file_name)
 					panic("Relative-deadline-us must be between 0 and %ld, was %ld\n",
 					      (int64_t)RUNTIME_EXPECTED_EXECUTION_US_MAX, buffer);
 				expected_execution_us = (uint32_t)buffer;
+			} else if (strcmp(key, "reservation-budget-us") == 0) {
+				int64_t buffer = strtoll(val, NULL, 10);
+				if (buffer < 0 || buffer > (int64_t)RUNTIME_RELATIVE_DEADLINE_US_MAX)
+					panic("reservation-budget-us must be between 0 and %ld, was %ld\n",
+					      (int64_t)RUNTIME_RELATIVE_DEADLINE_US_MAX, buffer);
+				reservation_budget_us = (uint32_t)buffer;
+			} else if (strcmp(key, "reservation-period-us") == 0) {
+				int64_t buffer = strtoll(val, NULL, 10);
+				if (buffer < 0 || buffer > (int64_t)RUNTIME_RELATIVE_DEADLINE_US_MAX)
+					panic("reservation-period-us must be between 0 and %ld, was %ld\n",
+					      (int64_t)RUNTIME_RELATIVE_DEADLINE_US_MAX, buffer);
+				reservation_period_us = (uint32_t)buffer;
+			} else if (strcmp(key, "max-concurrency") == 0) {
+				int64_t buffer = strtoll(val, NULL, 10);
+				if (buffer < 0 || buffer > (int64_t)RUNTIME_MAX_SANDBOX_REQUEST_COUNT)
+					panic("max-concurrency must be between 0 and %ld, was %ld\n",
+					      (int64_t)RUNTIME_MAX_SANDBOX_REQUEST_COUNT, buffer);
+				max_concurrency = (uint32_t)buffer;
+			} else if (strcmp(key, "max-queued") == 0) {
+				int64_t buffer = strtoll(val, NULL, 10);
+				if (buffer < 0 || buffer > (int64_t)RUNTIME_MAX_SANDBOX_REQUEST_COUNT)
+					panic("max-queued must be between 0 and %ld, was %ld\n",
+					      (int64_t)RUNTIME_MAX_SANDBOX_REQUEST_COUNT, buffer);
+				max_queued = (uint32_t)buffer;
+			} else if (strcmp(key, "worker-pool") == 0) {
+				int buffer = worker_pools_find(val);
+				if (buffer < 0) panic("worker-pool %s is not defined in SLEDGE_WORKER_POOLS\n", val);
+				pool_idx = (uint32_t)buffer;
+			} else if (strcmp(key, "slo-miss-permille") == 0) {
+				int64_t buffer = strtoll(val, NULL, 10);
+				if (buffer < 0 || buffer > MODULE_SLO_MISS_PERMILLE_MAX)
+					panic("slo-miss-permille must be between 0 and %d, was %ld\n",
+					      MODULE_SLO_MISS_PERMILLE_MAX, buffer);
+				slo_miss_permille = (uint32_t)buffer;
 			} else if (strcmp(key, "admissions-percentile") == 0) {
 				int32_t buffer = strtol(val, NULL, 10);
 				if (buffer > 99 || buffer < 50)
@@ -540,11 +630,27 @@ module_new_from_json(char *file_name)
 			      "%d\n",
 			      ADMISSIONS_CONTROL_GRANULARITY);
 #else
-		/* relative-deadline-us is required if scheduler is EDF */
-		if (scheduler == SCHEDULER_EDF && relative_deadline_us == 0)
+		/* relative-deadline-us is required if the scheduler of the module's pool is EDF or LLF */
+		enum SCHEDULER policy = worker_pools[pool_idx].scheduler;
+		if ((policy == SCHEDULER_EDF || policy == SCHEDULER_LLF) && relative_deadline_us == 0)
 			panic("relative_deadline_us is required\n");
+
+		/* expected-execution-us is required if the scheduler of the module's pool is LLF or SRPT */
+		if ((policy == SCHEDULER_LLF || policy == SCHEDULER_SRPT) && expected_execution_us == 0)
+			panic("expected-execution-us is required\n");
 #endif
 
+		/* reservation-budget-us and reservation-period-us are set together, and the budget cannot exceed the period */
+		if ((reservation_budget_us == 0) != (reservation_period_us == 0))
+			panic("reservation-budget-us and reservation-period-us must be set together\n");
+		if (reservation_budget_us > reservation_period_us)
+			panic("reservation-budget-us cannot exceed reservation-period-us\n");
+
+		/* max-queued requires max-concurrency, and releasing queued requests from workers requires a minheap */
+		if (max_queued > 0 && max_concurrency == 0) panic("max-queued requires max-concurrency\n");
+		if (max_concurrency > 0 && scheduler == SCHEDULER_FIFO)
+			panic("max-concurrency is only valid with minheap schedulers\n");
+
 		/* argsize defaults to 0 if absent */
 		/* http-req-headers defaults to empty if absent */
 		/* http-req-headers defaults to empty if absent */
@@ -553,7 +659,9 @@ module_new_from_json(char *file_name)
 			/* Allocate a module based on the values from the JSON */
 			struct module *module = module_new(module_name, module_path, argument_count, 0, 0,
 			                                   relative_deadline_us, port, request_size, response_size,
-			                                   admissions_percentile, expected_execution_us);
+			                                   admissions_percentile, expected_execution_us,
+			                                   reservation_budget_us, reservation_period_us, max_concurrency,
+			                                   max_queued, pool_idx, slo_miss_permille);
 			if (module == NULL) goto module_new_err;
 
 			assert(module);
@@ -0,0 +1,68 @@
+#include "global_request_scheduler.h"
+#include "module_concurrency.h"
+#include "sandbox_request.h"
+
+/**
+ * Hands a newly admitted request to the global request scheduler if the module has a free slot, or queues it
+ * Called by the listener thread
+ * @param self
+ * @param sandbox_request
+ * @returns whether the request was released, queued, or must be rejected by the caller
+ */
+enum MODULE_CONCURRENCY_ADMIT
+module_concurrency_admit(struct module_concurrency *self, struct sandbox_request *sandbox_request)
+{
+	assert(sandbox_request != NULL);
+
+	if (!module_concurrency_is_enabled(self)) {
+		global_request_scheduler_add(sandbox_request);
+		return MODULE_CONCURRENCY_ADMIT_RELEASED;
+	}
+
+	enum MODULE_CONCURRENCY_ADMIT result;
+
+	LOCK_LOCK(&self->lock);
+	if (self->concurrency < self->max_concurrency) {
+		self->concurrency++;
+		result = MODULE_CONCURRENCY_ADMIT_RELEASED;
+	} else if (self->queued_count < self->max_queued) {
+		self->queued[(self->queued_head + self->queued_count) % self->max_queued] = sandbox_request;
+		self->queued_count++;
+		result = MODULE_CONCURRENCY_ADMIT_QUEUED;
+	} else {
+		result = MODULE_CONCURRENCY_ADMIT_FULL;
+	}
+	LOCK_UNLOCK(&self->lock);
+
+	/* Keep the global request scheduler's lock out of the critical section */
+	if (result == MODULE_CONCURRENCY_ADMIT_RELEASED) global_request_scheduler_add(sandbox_request);
+
+	return result;
+}
+
+/**
+ * Releases a slot held by a request that completed, errored, or was rejected after admission. If requests are
+ * queued, the oldest inherits the slot and is handed to the global request scheduler
+ * Requires a global request scheduler that supports adds from worker threads
+ * @param self
+ */
+void
+module_concurrency_release(struct module_concurrency *self)
+{
+	if (!module_concurrency_is_enabled(self)) return;
+
+	struct sandbox_request *next = NULL;
+
+	LOCK_LOCK(&self->lock);
+	assert(self->concurrency > 0);
+	if (self->queued_count > 0) {
+		next              = self->queued[self->queued_head];
+		self->queued_head = (self->queued_head + 1) % self->max_queued;
+		self->queued_count--;
+	} else {
+		self->concurrency--;
+	}
+	LOCK_UNLOCK(&self->lock);
+
+	if (next != NULL) global_request_scheduler_add(next);
+}
@@ -0,0 +1,54 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics_server.h"
+#include "module_latency.h"
+
+const char *module_latency_metric_labels[MODULE_LATENCY_METRIC_COUNT] = {
+	[MODULE_LATENCY_END_TO_END] = "end_to_end",
+	[MODULE_LATENCY_QUEUED]     = "queued",
+	[MODULE_LATENCY_RUNNING]    = "running",
+	[MODULE_LATENCY_BLOCKED]    = "blocked",
+};
+
+/**
+ * Allocates the per-worker histograms if the metrics server is enabled
+ * @param self
+ */
+void
+module_latency_initialize(struct module_latency *self)
+{
+	self->workers = NULL;
+	if (!metrics_server_is_enabled()) return;
+
+	self->workers = runtime_allocate_per_worker(sizeof(struct module_latency_worker));
+}
+
+/**
+ * Frees the per-worker histograms
+ * @param self
+ */
+void
+module_latency_deinitialize(struct module_latency *self)
+{
+	free(self->workers);
+	self->workers = NULL;
+}
+
+/**
+ * Merges the histograms of all workers
+ * @param self
+ * @param merged private histograms, indexed by enum module_latency_metric
+ */
+void
+module_latency_merge(struct module_latency *self, struct latency_histogram merged[MODULE_LATENCY_METRIC_COUNT])
+{
+	memset(merged, 0, MODULE_LATENCY_METRIC_COUNT * sizeof(struct latency_histogram));
+	if (self->workers == NULL) return;
+
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		for (int j = 0; j < MODULE_LATENCY_METRIC_COUNT; j++) {
+			latency_histogram_merge(&merged[j], &self->workers[i].histograms[j]);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics_server.h"
+#include "module_memory_profile.h"
+
+const char *module_memory_profile_metric_labels[MODULE_MEMORY_PROFILE_METRIC_COUNT] = {
+	[MODULE_MEMORY_PROFILE_PAGES]           = "memory_pages",
+	[MODULE_MEMORY_PROFILE_GROWTH_PAGES]    = "memory_growth_pages",
+	[MODULE_MEMORY_PROFILE_GROWTH_DURATION] = "memory_growth_nanoseconds",
+};
+
+/**
+ * Allocates the per-worker histograms if the metrics server is enabled
+ * @param self
+ */
+void
+module_memory_profile_initialize(struct module_memory_profile *self)
+{
+	self->workers = NULL;
+	if (!metrics_server_is_enabled()) return;
+
+	self->workers = runtime_allocate_per_worker(sizeof(struct module_memory_profile_worker));
+}
+
+/**
+ * Frees the per-worker histograms
+ * @param self
+ */
+void
+module_memory_profile_deinitialize(struct module_memory_profile *self)
+{
+	free(self->workers);
+	self->workers = NULL;
+}
+
+/**
+ * Merges the histograms of all workers
+ * @param self
+ * @param merged private histograms, indexed by enum module_memory_profile_metric
+ */
+void
+module_memory_profile_merge(struct module_memory_profile *self,
+                            struct latency_histogram      merged[MODULE_MEMORY_PROFILE_METRIC_COUNT])
+{
+	memset(merged, 0, MODULE_MEMORY_PROFILE_METRIC_COUNT * sizeof(struct latency_histogram));
+	if (self->workers == NULL) return;
+
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		for (int j = 0; j < MODULE_MEMORY_PROFILE_METRIC_COUNT; j++) {
+			latency_histogram_merge(&merged[j], &self->workers[i].histograms[j]);
+		}
+	}
+}
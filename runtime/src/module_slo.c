@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch/getcycles.h"
+#include "module_slo.h"
+
+const char *module_slo_outcome_labels[MODULE_SLO_OUTCOME_COUNT] = {
+	[MODULE_SLO_ADMITTED] = "admitted",
+	[MODULE_SLO_REJECTED] = "rejected",
+	[MODULE_SLO_ON_TIME]  = "on_time",
+	[MODULE_SLO_LATE]     = "late",
+	[MODULE_SLO_ERRORED]  = "errored",
+};
+
+/**
+ * Allocates the outcome counters of a module and starts its window
+ * @param self
+ * @param miss_threshold_permille deadline misses per thousand completions above which an event is logged. 0 disables
+ */
+void
+module_slo_initialize(struct module_slo *self, uint32_t miss_threshold_permille)
+{
+	assert(miss_threshold_permille <= MODULE_SLO_MISS_PERMILLE_MAX);
+
+	self->shards                  = counter_shard_allocate(sizeof(struct module_slo_shard));
+	self->miss_threshold_permille = miss_threshold_permille;
+	self->window_head             = 0;
+	self->is_missing              = false;
+	for (int i = 0; i < MODULE_SLO_WINDOW_COUNT; i++) {
+		self->window_completions[i] = 0;
+		self->window_misses[i]      = 0;
+	}
+	atomic_init(&self->miss_permille, 0);
+	atomic_init(&self->window_last_slide, __getcycles());
+	atomic_init(&self->is_sliding, false);
+}
+
+void
+module_slo_deinitialize(struct module_slo *self)
+{
+	free(self->shards);
+	self->shards = NULL;
+}
+
+/**
+ * Sums the outcome counters of all shards
+ * @param self
+ * @param totals indexed by enum module_slo_outcome
+ */
+void
+module_slo_sum(struct module_slo *self, uint64_t totals[MODULE_SLO_OUTCOME_COUNT])
+{
+	for (int j = 0; j < MODULE_SLO_OUTCOME_COUNT; j++) totals[j] = 0;
+
+	for (uint32_t i = 0; i < counter_shard_count(); i++) {
+		for (int j = 0; j < MODULE_SLO_OUTCOME_COUNT; j++) {
+			totals[j] += atomic_load_explicit(&self->shards[i].outcomes[j], memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * Slides the window by a period, updating the miss ratio and logging threshold crossings
+ * Only called by the worker that claimed the period in module_slo_record_completion. Skipped if the slide of an
+ * earlier period is still in progress
+ * @param self
+ * @param module_name used in events
+ */
+void
+module_slo_slide_window(struct module_slo *self, const char *module_name)
+{
+	/* Acquire the window written by the previous slide */
+	if (atomic_exchange_explicit(&self->is_sliding, true, memory_order_acquire)) return;
+
+	uint64_t totals[MODULE_SLO_OUTCOME_COUNT];
+	module_slo_sum(self, totals);
+
+	uint64_t completions = totals[MODULE_SLO_ON_TIME] + totals[MODULE_SLO_LATE];
+	uint64_t misses      = totals[MODULE_SLO_LATE];
+
+	uint64_t window_completions = completions - self->window_completions[self->window_head];
+	uint64_t window_misses      = misses - self->window_misses[self->window_head];
+
+	self->window_completions[self->window_head] = completions;
+	self->window_misses[self->window_head]      = misses;
+	self->window_head                           = (self->window_head + 1) % MODULE_SLO_WINDOW_COUNT;
+
+	uint32_t miss_permille = window_completions > 0
+	                           ? window_misses * MODULE_SLO_MISS_PERMILLE_MAX / window_completions
+	                           : 0;
+	atomic_store_explicit(&self->miss_permille, miss_permille, memory_order_relaxed);
+
+	if (self->miss_threshold_permille == 0 || window_completions < MODULE_SLO_WINDOW_MIN_COMPLETIONS) goto done;
+
+	if (!self->is_missing && miss_permille > self->miss_threshold_permille) {
+		self->is_missing = true;
+		fprintf(stderr, "Module %s missed %u/1000 deadlines over its %d s window, above its SLO of %u/1000\n",
+		        module_name, miss_permille, MODULE_SLO_WINDOW_COUNT * MODULE_SLO_WINDOW_PERIOD_US / 1000000,
+		        self->miss_threshold_permille);
+	} else if (self->is_missing && miss_permille <= self->miss_threshold_permille) {
+		self->is_missing = false;
+		fprintf(stderr, "Module %s recovered to %u/1000 deadline misses, within its SLO of %u/1000\n",
+		        module_name, miss_permille, self->miss_threshold_permille);
+	}
+
+done:
+	/* Publish the window to the next slide */
+	atomic_store_explicit(&self->is_sliding, false, memory_order_release);
+}
@@ -0,0 +1,49 @@
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "debuglog.h"
+#include "numa_topology.h"
+
+/**
+ * Discovers the NUMA node of a CPU from sysfs, which links each CPU to its node as cpu<N>/node<K>
+ * This avoids a dependency on libnuma
+ * @param cpu
+ * @returns the node, or 0 if the kernel does not expose NUMA topology
+ */
+int
+numa_topology_get_node_of_cpu(uint32_t cpu)
+{
+	char path[64];
+
+	for (int node = 0; node < NUMA_TOPOLOGY_NODE_MAX; node++) {
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/node%d", cpu, node);
+		if (access(path, F_OK) == 0) return node;
+	}
+
+	return 0;
+}
+
+/**
+ * Prefers allocating the pages of a region from a NUMA node
+ * This is a preference rather than a strict binding, so allocation falls back to other nodes under memory pressure
+ * @param addr page-aligned start of the region
+ * @param length length of the region in bytes
+ * @param node
+ * @returns 0 on success, -1 on error
+ */
+int
+numa_topology_bind(void *addr, size_t length, int node)
+{
+	unsigned long nodemask = 1UL << node;
+
+	if (syscall(SYS_mbind, addr, length, MPOL_PREFERRED, &nodemask, NUMA_TOPOLOGY_NODE_MAX + 1, 0) < 0) {
+		debuglog("mbind to node %d failed: %s\n", node, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,164 @@
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include "panic.h"
+#include "perf_counters.h"
+#include "runtime.h"
+#include "worker_thread.h"
+
+const char *perf_counters_event_labels[PERF_COUNTERS_EVENT_COUNT] = {
+	[PERF_COUNTERS_CYCLES]       = "cycles",
+	[PERF_COUNTERS_INSTRUCTIONS] = "instructions",
+	[PERF_COUNTERS_LLC_MISSES]   = "llc_misses",
+	[PERF_COUNTERS_DTLB_MISSES]  = "dtlb_misses",
+};
+
+bool              perf_counters_enabled       = false;
+_Atomic uint32_t *perf_counters_worker_events = NULL;
+
+__thread int      perf_counters_group_file_descriptor = -1;
+__thread int      perf_counters_group_index[PERF_COUNTERS_EVENT_COUNT];
+__thread uint64_t perf_counters_switch_in_counts[PERF_COUNTERS_EVENT_COUNT];
+
+/**
+ * Opens a counter of the calling thread in user space
+ * @param event
+ * @param group_file_descriptor leader of the group, or -1 to open a leader
+ * @returns file descriptor or -1 on error
+ */
+static int
+perf_counters_open(enum perf_counters_event event, int group_file_descriptor)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size           = sizeof(attr);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv     = 1;
+	attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.disabled       = group_file_descriptor < 0; /* The leader enables the group once it is complete */
+
+	switch (event) {
+	case PERF_COUNTERS_CYCLES:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PERF_COUNTERS_INSTRUCTIONS:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PERF_COUNTERS_LLC_MISSES:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case PERF_COUNTERS_DTLB_MISSES:
+		attr.type   = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	default:
+		panic("Unexpected perf counter event %d\n", event);
+	}
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group_file_descriptor, 0);
+}
+
+/**
+ * Allocates the bitmasks of the events counted by each worker. Called before the workers start
+ */
+void
+perf_counters_initialize(void)
+{
+	if (!perf_counters_enabled) return;
+
+	perf_counters_worker_events = runtime_allocate_per_worker(sizeof(_Atomic uint32_t));
+}
+
+/**
+ * Opens the counter group of the calling worker. If the group cannot be opened, for example because
+ * /proc/sys/kernel/perf_event_paranoid forbids it, counters stay disabled on the worker and its events are reported as
+ * unavailable
+ */
+void
+perf_counters_initialize_worker(void)
+{
+	if (!perf_counters_enabled) return;
+
+	int leader = perf_counters_open(PERF_COUNTERS_CYCLES, -1);
+	if (leader < 0) {
+		fprintf(stderr, "Worker %d: perf counters disabled, failed to open cycles counter: %s\n",
+		        worker_thread_idx, strerror(errno));
+		return;
+	}
+
+	int      members[PERF_COUNTERS_EVENT_COUNT];
+	int      position = 0;
+	uint32_t events   = 1U << PERF_COUNTERS_CYCLES;
+
+	members[position]                               = leader;
+	perf_counters_group_index[PERF_COUNTERS_CYCLES] = position++;
+	for (int i = PERF_COUNTERS_CYCLES + 1; i < PERF_COUNTERS_EVENT_COUNT; i++) {
+		int file_descriptor = perf_counters_open(i, leader);
+		if (file_descriptor < 0) {
+			fprintf(stderr, "Worker %d: perf counter %s is not supported: %s\n", worker_thread_idx,
+			        perf_counters_event_labels[i], strerror(errno));
+			perf_counters_group_index[i] = -1;
+			continue;
+		}
+		members[position]            = file_descriptor;
+		perf_counters_group_index[i] = position++;
+		events |= 1U << i;
+	}
+
+	if (ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0) {
+		fprintf(stderr, "Worker %d: perf counters disabled, failed to enable: %s\n", worker_thread_idx,
+		        strerror(errno));
+		/* Close the members before the leader */
+		for (int i = position - 1; i >= 0; i--) close(members[i]);
+		return;
+	}
+
+	perf_counters_group_file_descriptor = leader;
+	atomic_store_explicit(&perf_counters_worker_events[worker_thread_idx], events, memory_order_relaxed);
+}
+
+/**
+ * Allocates the per-worker totals of a module if counters are enabled
+ * @param module_totals set to the totals, or to NULL if counters are disabled
+ */
+void
+perf_counters_module_initialize(struct perf_counters_module_worker **module_totals)
+{
+	*module_totals = NULL;
+	if (!perf_counters_enabled) return;
+
+	*module_totals = runtime_allocate_per_worker(sizeof(struct perf_counters_module_worker));
+}
+
+/**
+ * Sums the per-worker totals of a module
+ * An event that some worker does not count is unavailable, as the sum would silently omit the sandboxes of the worker
+ * @param module_totals
+ * @param sums indexed by enum perf_counters_event. PERF_COUNTERS_UNAVAILABLE for events that are not available
+ */
+void
+perf_counters_module_sum(struct perf_counters_module_worker *module_totals, uint64_t sums[PERF_COUNTERS_EVENT_COUNT])
+{
+	memset(sums, 0, PERF_COUNTERS_EVENT_COUNT * sizeof(uint64_t));
+	if (module_totals == NULL) return;
+
+	uint32_t available_events = UINT32_MAX;
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		available_events &= atomic_load_explicit(&perf_counters_worker_events[i], memory_order_relaxed);
+		for (int j = 0; j < PERF_COUNTERS_EVENT_COUNT; j++) {
+			sums[j] += atomic_load_explicit(&module_totals[i].totals[j], memory_order_relaxed);
+		}
+	}
+
+	for (int j = 0; j < PERF_COUNTERS_EVENT_COUNT; j++) {
+		if ((available_events & (1U << j)) == 0) sums[j] = PERF_COUNTERS_UNAVAILABLE;
+	}
+}
@@ -4,6 +4,7 @@
 #include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -18,20 +19,67 @@
 #include "global_request_scheduler_minheap.h"
 #include "http_parser_settings.h"
 #include "listener_thread.h"
+#include "lock_profile.h"
 #include "module.h"
+#include "panic.h"
 #include "runtime.h"
+#include "perf_counters.h"
+#include "sandbox_perf_log.h"
+#include "sandbox_trace.h"
 #include "sandbox_request.h"
 #include "scheduler.h"
 #include "software_interrupt.h"
+#include "worker_pool.h"
+#include "worker_thread_idle.h"
 
 /***************************
  * Shared Process State    *
  **************************/
 
-pthread_t runtime_worker_threads[RUNTIME_WORKER_THREAD_CORE_COUNT];
-int       runtime_worker_threads_argument[RUNTIME_WORKER_THREAD_CORE_COUNT] = { 0 };
+/* Per-worker state, allocated once the number of workers is known */
+pthread_t *runtime_worker_threads          = NULL;
+int *      runtime_worker_threads_argument = NULL;
+/* The core each worker thread is pinned to */
+uint32_t *runtime_worker_threads_core = NULL;
 /* The active deadline of the sandbox running on each worker thread */
-uint64_t runtime_worker_threads_deadline[RUNTIME_WORKER_THREAD_CORE_COUNT] = { UINT64_MAX };
+struct runtime_worker_deadline *runtime_worker_threads_deadline = NULL;
+
+/**
+ * Allocates a zeroed array aligned to a cache line, so elements that are CACHE_ALIGNED do not share cache lines
+ * between the threads they belong to
+ * Such arrays are allocated during startup, so failure panics
+ * @param element_count number of elements
+ * @param element_size size of an element in bytes
+ * @returns the array
+ */
+void *
+runtime_allocate_cache_aligned(size_t element_count, size_t element_size)
+{
+	assert(element_count > 0);
+
+	size_t size  = element_size * element_count;
+	size_t round = (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+	void *array = aligned_alloc(CACHE_LINE_SIZE, round);
+	if (unlikely(array == NULL))
+		panic("Failed to allocate %zu cache aligned elements of %zu bytes\n", element_count, element_size);
+	memset(array, 0, round);
+
+	return array;
+}
+
+/**
+ * Allocates a zeroed, cache aligned array with one element per worker thread
+ * @param element_size size of an element in bytes
+ * @returns the array
+ */
+void *
+runtime_allocate_per_worker(size_t element_size)
+{
+	assert(runtime_worker_threads_count > 0);
+
+	return runtime_allocate_cache_aligned(runtime_worker_threads_count, element_size);
+}
 
 /******************************************
  * Shared Process / Listener Thread Logic *
@@ -40,9 +88,14 @@ uint64_t runtime_worker_threads_deadline[RUNTIME_WORKER_THREAD_CORE_COUNT] = { U
 void
 runtime_cleanup()
 {
-	if (runtime_sandbox_perf_log != NULL) fflush(runtime_sandbox_perf_log);
+	sandbox_perf_log_stop();
+	sandbox_trace_dump();
+	lock_profile_print();
 
 	software_interrupt_deferred_sigalrm_max_print();
+	software_interrupt_deferred_sigalrm_delay_print();
+	worker_pools_cross_node_steals_print();
+	worker_thread_idle_wakeup_latency_print();
 	exit(EXIT_SUCCESS);
 }
 
@@ -104,6 +157,8 @@ runtime_initialize(void)
 
 	http_parser_settings_initialize();
 	admissions_control_initialize();
+	worker_thread_idle_initialize();
+	perf_counters_initialize();
 }
 
 static void
@@ -3,10 +3,13 @@
 
 #include "current_sandbox.h"
 #include "debuglog.h"
+#include "numa_topology.h"
 #include "panic.h"
 #include "sandbox_functions.h"
 #include "sandbox_set_as_error.h"
 #include "sandbox_set_as_initialized.h"
+#include "worker_pool.h"
+#include "worker_thread.h"
 
 /**
  * Close the sandbox's ith io_handle
@@ -65,6 +68,13 @@ sandbox_allocate_memory(struct module *module)
 		goto set_rw_failed;
 	}
 
+	/*
+	 * Prefer the NUMA node of the allocating worker before the pages are first touched. Pages added when linear memory
+	 * is expanded are remapped and fall back to the default first-touch policy, which places them on the same node
+	 */
+	if (runtime_numa_enabled)
+		numa_topology_bind(addr_rw, sandbox_size + linear_memory_size, worker_pools[worker_thread_pool_idx].node);
+
 	sandbox = (struct sandbox *)addr_rw;
 
 	/* Populate Sandbox members */
@@ -108,6 +118,9 @@ sandbox_allocate_stack(struct sandbox *sandbox)
 	/* TODO: Fix leak here. Issue #132 */
 	if (addr_rw == MAP_FAILED) goto err_stack_allocation_failed;
 
+	if (runtime_numa_enabled)
+		numa_topology_bind(addr_rw, sandbox->module->stack_size, worker_pools[worker_thread_pool_idx].node);
+
 	sandbox->stack_start = addr_rw;
 	sandbox->stack_size  = sandbox->module->stack_size;
 
@@ -162,9 +175,6 @@ err_stack_allocation_failed:
 	 */
 	sandbox->state                       = SANDBOX_SET_AS_INITIALIZED;
 	sandbox->last_state_change_timestamp = now;
-#ifdef LOG_SANDBOX_MEMORY_PROFILE
-	sandbox->page_allocation_timestamps_size = 0;
-#endif
 	ps_list_init_d(sandbox);
 err_memory_allocation_failed:
 	sandbox_set_as_error(sandbox, SANDBOX_SET_AS_INITIALIZED);
@@ -0,0 +1,157 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "panic.h"
+#include "sandbox_perf_log.h"
+#include "sandbox_state.h"
+
+struct sandbox_perf_log_ring *sandbox_perf_log_rings = NULL;
+
+static int          sandbox_perf_log_file_descriptor = -1;
+static pthread_t    sandbox_perf_log_writer;
+static _Atomic bool sandbox_perf_log_is_stopping = false;
+
+/**
+ * Writes a buffer to the log, retrying partial writes
+ * @param buffer
+ * @param length in bytes
+ */
+static void
+sandbox_perf_log_write(const void *buffer, size_t length)
+{
+	const char *cursor = buffer;
+	while (length > 0) {
+		ssize_t written = write(sandbox_perf_log_file_descriptor, cursor, length);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			perror("sandbox perf log write");
+			return;
+		}
+		cursor += written;
+		length -= written;
+	}
+}
+
+/**
+ * Writes the records published to a ring since the last drain, in at most two contiguous batches
+ * @param ring
+ * @returns the number of records written
+ */
+static uint64_t
+sandbox_perf_log_drain(struct sandbox_perf_log_ring *ring)
+{
+	uint64_t tail  = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uint64_t head  = atomic_load_explicit(&ring->head, memory_order_acquire);
+	uint64_t count = head - tail;
+	if (count == 0) return 0;
+
+	uint64_t start = tail & (SANDBOX_PERF_LOG_RING_CAPACITY - 1);
+	uint64_t first = SANDBOX_PERF_LOG_RING_CAPACITY - start;
+	if (first > count) first = count;
+
+	sandbox_perf_log_write(&ring->records[start], first * sizeof(struct sandbox_perf_log_record));
+	if (count > first)
+		sandbox_perf_log_write(&ring->records[0], (count - first) * sizeof(struct sandbox_perf_log_record));
+
+	/* Release the slots to the worker */
+	atomic_store_explicit(&ring->tail, head, memory_order_release);
+	return count;
+}
+
+/**
+ * The writer thread. Drains the rings of all workers, sleeping when they are empty, and drains them a final time when
+ * the runtime stops
+ */
+static void *
+sandbox_perf_log_writer_main(void *argument)
+{
+	/*
+	 * SIGTERM must be handled by another thread, as runtime_cleanup joins this thread. This thread is created before
+	 * the main thread masks the preemption signals, so it also masks SIGALRM and SIGUSR1, which only workers handle
+	 */
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGTERM);
+	sigaddset(&set, SIGALRM);
+	sigaddset(&set, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	const struct timespec period = { .tv_sec  = SANDBOX_PERF_LOG_WRITER_PERIOD_US / 1000000,
+		                         .tv_nsec = (SANDBOX_PERF_LOG_WRITER_PERIOD_US % 1000000) * 1000 };
+
+	while (true) {
+		bool is_stopping = atomic_load(&sandbox_perf_log_is_stopping);
+
+		uint64_t written = 0;
+		for (int i = 0; i < runtime_worker_threads_count; i++) {
+			written += sandbox_perf_log_drain(&sandbox_perf_log_rings[i]);
+		}
+
+		if (is_stopping) break;
+		if (written == 0) nanosleep(&period, NULL);
+	}
+
+	return NULL;
+}
+
+/**
+ * Opens the log, writes its header, and starts the writer thread
+ * @param path
+ */
+void
+sandbox_perf_log_initialize(char *path)
+{
+	sandbox_perf_log_file_descriptor = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (sandbox_perf_log_file_descriptor < 0) {
+		perror("sandbox perf log");
+		return;
+	}
+
+	struct sandbox_perf_log_header header = { .magic        = SANDBOX_PERF_LOG_MAGIC,
+		                                  .version      = SANDBOX_PERF_LOG_VERSION,
+		                                  .record_size  = sizeof(struct sandbox_perf_log_record),
+		                                  .state_count  = SANDBOX_STATE_COUNT,
+		                                  .label_length = SANDBOX_PERF_LOG_LABEL_LENGTH };
+	sandbox_perf_log_write(&header, sizeof(header));
+
+	for (int i = 0; i < SANDBOX_STATE_COUNT; i++) {
+		char label[SANDBOX_PERF_LOG_LABEL_LENGTH] = { 0 };
+		strncpy(label, sandbox_state_labels[i], SANDBOX_PERF_LOG_LABEL_LENGTH - 1);
+		sandbox_perf_log_write(label, SANDBOX_PERF_LOG_LABEL_LENGTH);
+	}
+
+	sandbox_perf_log_rings = runtime_allocate_per_worker(sizeof(struct sandbox_perf_log_ring));
+
+	int rc = pthread_create(&sandbox_perf_log_writer, NULL, sandbox_perf_log_writer_main, NULL);
+	if (rc != 0) {
+		errno = rc;
+		panic_err();
+	}
+}
+
+/**
+ * Stops the writer thread after it drains the rings, closes the log, and prints the logging overhead of each worker
+ */
+void
+sandbox_perf_log_stop(void)
+{
+	if (!sandbox_perf_log_is_enabled()) return;
+
+	atomic_store(&sandbox_perf_log_is_stopping, true);
+	pthread_join(sandbox_perf_log_writer, NULL);
+	close(sandbox_perf_log_file_descriptor);
+
+	printf("Sandbox Perf Log (records, dropped, mean cycles per record)\n");
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		struct sandbox_perf_log_ring *ring    = &sandbox_perf_log_rings[i];
+		uint64_t                      records = atomic_load(&ring->head);
+		printf("Worker %d: %lu, %lu, %lu\n", i, records, ring->dropped, records > 0 ? ring->cycles / records : 0);
+	}
+	fflush(stdout);
+}
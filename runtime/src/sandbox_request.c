@@ -1,3 +1,6 @@
 #include "sandbox_request.h"
 
-_Atomic uint32_t sandbox_request_count = 0;
+_Atomic uint64_t sandbox_request_count = 0;
+
+__thread uint64_t sandbox_request_id_next = 0;
+__thread uint64_t sandbox_request_id_end  = 0;
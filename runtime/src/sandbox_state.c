@@ -35,9 +35,29 @@ const char *sandbox_state_labels[SANDBOX_STATE_COUNT] = {
 	[SANDBOX_ERROR]              = "Error"
 };
 
-#ifdef LOG_SANDBOX_COUNT
-_Atomic uint32_t sandbox_state_count[SANDBOX_STATE_COUNT];
-#endif
+struct sandbox_state_count_shard *sandbox_state_count_shards = NULL;
+
+void
+sandbox_count_initialize(void)
+{
+	sandbox_state_count_shards = counter_shard_allocate(sizeof(struct sandbox_state_count_shard));
+}
+
+/**
+ * Sums the shards of all threads. Shards are read one at a time, so the sums of different states are not a consistent
+ * snapshot
+ * @param state
+ * @returns the number of sandboxes in the state
+ */
+int64_t
+sandbox_state_count_sum(sandbox_state_t state)
+{
+	int64_t sum = 0;
+	for (uint32_t i = 0; i < counter_shard_count(); i++) {
+		sum += atomic_load_explicit(&sandbox_state_count_shards[i].count[state], memory_order_relaxed);
+	}
+	return sum;
+}
 
 /*
  * Function intended to be interactively run in a debugger to look at sandbox totals
@@ -46,20 +66,15 @@ _Atomic uint32_t sandbox_state_count[SANDBOX_STATE_COUNT];
 void
 runtime_log_sandbox_states()
 {
-#ifdef LOG_SANDBOX_COUNT
-	const size_t buffer_size         = 1000;
-	char         buffer[buffer_size] = "";
+	char buffer[1000] = "";
 	for (int i = 0; i < SANDBOX_STATE_COUNT; i++) {
-		const size_t tiny_buffer_size              = 50;
-		char         tiny_buffer[tiny_buffer_size] = "";
-		snprintf(tiny_buffer, tiny_buffer_size - 1, "%s: %u\n\t", sandbox_state_stringify(i),
-		         atomic_load(&sandbox_state_count[i]));
-		strncat(buffer, tiny_buffer, buffer_size - 1 - strlen(buffer));
+		if (!sandbox_state_is_terminal[i]) continue;
+
+		char tiny_buffer[50] = "";
+		snprintf(tiny_buffer, sizeof(tiny_buffer) - 1, "%s: %ld\n\t", sandbox_state_stringify(i),
+		         sandbox_state_count_sum(i));
+		strncat(buffer, tiny_buffer, sizeof(buffer) - 1 - strlen(buffer));
 	}
 
 	debuglog("%s", buffer);
-
-#else
-	debuglog("Must compile with LOG_SANDBOX_COUNT for this functionality!\n");
-#endif
 };
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "module.h"
+#include "panic.h"
+#include "runtime.h"
+#include "sandbox_trace.h"
+
+struct sandbox_trace_ring *sandbox_trace_rings         = NULL;
+uint64_t                   sandbox_trace_ring_capacity = 0;
+_Atomic bool               sandbox_trace_is_enabled    = false;
+
+static char *sandbox_trace_path = NULL;
+
+/**
+ * Allocates the rings of all workers and starts recording
+ * @param path the trace is written to on exit
+ * @param capacity events per worker. Rounded up to a power of two
+ */
+void
+sandbox_trace_initialize(char *path, uint64_t capacity)
+{
+	sandbox_trace_ring_capacity = 1;
+	while (sandbox_trace_ring_capacity < capacity) sandbox_trace_ring_capacity <<= 1;
+
+	sandbox_trace_rings = runtime_allocate_per_worker(sizeof(struct sandbox_trace_ring));
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		sandbox_trace_rings[i].events = calloc(sandbox_trace_ring_capacity, sizeof(struct sandbox_trace_event));
+		if (unlikely(sandbox_trace_rings[i].events == NULL))
+			panic("Failed to allocate %lu trace events\n", sandbox_trace_ring_capacity);
+	}
+
+	sandbox_trace_path = path;
+	atomic_store(&sandbox_trace_is_enabled, true);
+}
+
+/**
+ * Returns the index of the oldest event of a ring that is safe to read. Once a ring wraps, its oldest slot may be
+ * overwritten by an event recorded while the trace is dumped, so that slot is skipped
+ * @param head events recorded by the ring
+ * @returns first event index
+ */
+static inline uint64_t
+sandbox_trace_get_first(uint64_t head)
+{
+	if (head <= sandbox_trace_ring_capacity) return 0;
+	return head - sandbox_trace_ring_capacity + 1;
+}
+
+/**
+ * Writes a string as a JSON string
+ * @param trace
+ * @param string
+ */
+static void
+sandbox_trace_write_string(FILE *trace, const char *string)
+{
+	fputc('"', trace);
+	for (; *string != '\0'; string++) {
+		if (*string == '"' || *string == '\\') fputc('\\', trace);
+		fputc(*string, trace);
+	}
+	fputc('"', trace);
+}
+
+/**
+ * Writes the fields of an async event on the track of a sandbox, leaving the event open for arguments
+ * @param trace
+ * @param phase b to begin a span, e to end it, or n for an instant
+ * @param label
+ * @param event
+ * @param worker_idx
+ * @param timestamp microseconds
+ */
+static void
+sandbox_trace_write_async(FILE *trace, char phase, const char *label, struct sandbox_trace_event *event,
+                          int worker_idx, double timestamp)
+{
+	fprintf(trace, ",\n{\"name\":\"%s\",\"cat\":\"sandbox\",\"ph\":\"%c\",\"id\":%lu,", label, phase,
+	        event->sandbox_id);
+	fprintf(trace, "\"pid\":1,\"tid\":%d,\"ts\":%.3f", worker_idx, timestamp);
+}
+
+/**
+ * Writes an event as Chrome trace events. Each state is an async span on the track of its sandbox, and running is
+ * additionally a complete event on the track of its worker, so that the workers show which sandbox ran when
+ * @param trace
+ * @param event
+ * @param worker_idx
+ * @param base cycles at time 0 of the trace
+ */
+static void
+sandbox_trace_write_event(FILE *trace, struct sandbox_trace_event *event, int worker_idx, uint64_t base)
+{
+	double start = (double)(event->start - base) / runtime_processor_speed_MHz;
+	double end   = (double)(event->end - base) / runtime_processor_speed_MHz;
+
+	const char *label = event->state == SANDBOX_TRACE_QUEUED ? "Queued" : sandbox_state_stringify(event->state);
+
+	/* Sandboxes end with an instant on the track of the sandbox */
+	if (event->state == SANDBOX_COMPLETE || event->state == SANDBOX_ERROR) {
+		sandbox_trace_write_async(trace, 'n', label, event, worker_idx, start);
+		fprintf(trace, "}");
+		return;
+	}
+
+	if (event->state == SANDBOX_RUNNING) {
+		fprintf(trace, ",\n{\"name\":");
+		sandbox_trace_write_string(trace, event->module->name);
+		fprintf(trace, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,", worker_idx, start,
+		        end - start);
+		fprintf(trace, "\"args\":{\"sandbox\":%lu}}", event->sandbox_id);
+	}
+
+	sandbox_trace_write_async(trace, 'b', label, event, worker_idx, start);
+	fprintf(trace, ",\"args\":{\"module\":");
+	sandbox_trace_write_string(trace, event->module->name);
+	fprintf(trace, "}}");
+
+	sandbox_trace_write_async(trace, 'e', label, event, worker_idx, end);
+	fprintf(trace, "}");
+}
+
+/**
+ * Stops recording and writes the events retained by the rings to the trace. Called on exit
+ */
+void
+sandbox_trace_dump(void)
+{
+	if (!atomic_load(&sandbox_trace_is_enabled)) return;
+	atomic_store(&sandbox_trace_is_enabled, false);
+
+	FILE *trace = fopen(sandbox_trace_path, "w");
+	if (trace == NULL) {
+		perror("sandbox trace");
+		return;
+	}
+
+	/* Events recorded by workers that have not yet observed that recording stopped are ignored */
+	uint64_t heads[runtime_worker_threads_count];
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		heads[i] = atomic_load_explicit(&sandbox_trace_rings[i].head, memory_order_acquire);
+	}
+
+	/* Timestamps are relative to the oldest retained event, as trace viewers handle small timestamps best */
+	uint64_t base = UINT64_MAX;
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		uint64_t head = heads[i];
+		for (uint64_t j = sandbox_trace_get_first(head); j < head; j++) {
+			uint64_t start = sandbox_trace_rings[i].events[j & (sandbox_trace_ring_capacity - 1)].start;
+			if (start < base) base = start;
+		}
+	}
+
+	fprintf(trace, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(trace, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"sledgert\"}}");
+
+	uint64_t written     = 0;
+	uint64_t overwritten = 0;
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		fprintf(trace, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,", i);
+		fprintf(trace, "\"args\":{\"name\":\"Worker %d\"}}", i);
+
+		uint64_t head  = heads[i];
+		uint64_t first = sandbox_trace_get_first(head);
+		for (uint64_t j = first; j < head; j++) {
+			uint64_t slot = j & (sandbox_trace_ring_capacity - 1);
+			sandbox_trace_write_event(trace, &sandbox_trace_rings[i].events[slot], i, base);
+		}
+		written += head - first;
+		overwritten += first;
+	}
+
+	fprintf(trace, "\n]}\n");
+	fclose(trace);
+
+	printf("Sandbox Trace: %lu events written to %s, %lu overwritten\n", written, sandbox_trace_path, overwritten);
+	fflush(stdout);
+}
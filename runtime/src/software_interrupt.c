@@ -37,23 +37,42 @@ __thread _Atomic static volatile sig_atomic_t software_interrupt_SIGUSR_count
 __thread _Atomic volatile sig_atomic_t        software_interrupt_deferred_sigalrm     = 0;
 __thread _Atomic volatile sig_atomic_t        software_interrupt_signal_depth         = 0;
 
-_Atomic volatile sig_atomic_t software_interrupt_deferred_sigalrm_max[RUNTIME_WORKER_THREAD_CORE_COUNT] = { 0 };
+/* Timestamp of the first SIGALRM deferred since the last scheduling decision */
+__thread volatile uint64_t software_interrupt_deferred_sigalrm_timestamp = 0;
+
+struct software_interrupt_deferred_sigalrm_stats *software_interrupt_deferred_sigalrm_stats = NULL;
 
 void
 software_interrupt_deferred_sigalrm_max_print()
 {
 	printf("Max Deferred Sigalrms\n");
 	for (int i = 0; i < runtime_worker_threads_count; i++) {
-		printf("Worker %d: %d\n", i, software_interrupt_deferred_sigalrm_max[i]);
+		printf("Worker %d: %d\n", i, software_interrupt_deferred_sigalrm_stats[i].max);
 	}
 	fflush(stdout);
 }
 
-/***************************************
- * Externs
- **************************************/
-
-extern pthread_t runtime_worker_threads[];
+void
+software_interrupt_deferred_sigalrm_delay_print()
+{
+	printf("Deferred Sigalrm Delays (us)\n");
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		printf("Worker %d:", i);
+		for (int j = 0; j < SOFTWARE_INTERRUPT_DEFERRED_SIGALRM_DELAY_BUCKET_COUNT; j++) {
+			if (software_interrupt_deferred_sigalrm_stats[i].delay[j] == 0) continue;
+
+			if (j == 0) {
+				printf(" <1: %u", software_interrupt_deferred_sigalrm_stats[i].delay[j]);
+			} else if (j == SOFTWARE_INTERRUPT_DEFERRED_SIGALRM_DELAY_BUCKET_COUNT - 1) {
+				printf(" >=%lu: %u", 1UL << (j - 1), software_interrupt_deferred_sigalrm_stats[i].delay[j]);
+			} else {
+				printf(" <%lu: %u", 1UL << j, software_interrupt_deferred_sigalrm_stats[i].delay[j]);
+			}
+		}
+		printf("\n");
+	}
+	fflush(stdout);
+}
 
 /**************************
  * Private Static Inlines *
@@ -78,9 +97,10 @@ sigalrm_propagate_workers(siginfo_t *signal_info)
 			/* If using EDF, conditionally send signals. If not, broadcast */
 			switch (runtime_sigalrm_handler) {
 			case RUNTIME_SIGALRM_HANDLER_TRIAGED: {
-				assert(scheduler == SCHEDULER_EDF);
-				uint64_t local_deadline  = runtime_worker_threads_deadline[i];
-				uint64_t global_deadline = global_request_scheduler_peek();
+				uint32_t pool_idx = worker_pools_get_idx_of_worker(i);
+				assert(worker_pools[pool_idx].scheduler == SCHEDULER_EDF);
+				uint64_t local_deadline  = runtime_worker_threads_deadline[i].deadline;
+				uint64_t global_deadline = global_request_scheduler_peek_pool(pool_idx);
 				if (global_deadline < local_deadline) pthread_kill(runtime_worker_threads[i], SIGALRM);
 				continue;
 			}
@@ -139,16 +159,19 @@ software_interrupt_handle_signals(int signal_type, siginfo_t *signal_info, void
 	switch (signal_type) {
 	case SIGALRM: {
 		sigalrm_propagate_workers(signal_info);
-		if (current_sandbox == NULL || current_sandbox->ctxt.preemptable == false) {
-			/* Cannot preempt, so defer signal
+		if (current_sandbox == NULL) {
+			/* The worker is looping through the scheduler in its base context, so the sigalrm is redundant */
+		} else if (current_sandbox->ctxt.preemptable == false) {
+			/* Cannot preempt, so defer signal. It is replayed when the sandbox enables preemption
 			 * TODO: First worker gets tons of kernel sigalrms, should these be treated the same?
-			 * When current_sandbox is NULL, we are looping through the scheduler, so sigalrm is redundant
-			 * Maybe track time of last scheduling decision? i.e. when scheduler_get_next was last called.
 			 */
-			atomic_fetch_add(&software_interrupt_deferred_sigalrm, 1);
+			software_interrupt_defer_sigalrm();
 		} else {
 			/* A worker thread received a SIGALRM while running a preemptable sandbox, so preempt */
 			assert(current_sandbox->state == SANDBOX_RUNNING);
+			/* Preempting takes the scheduler locks, which deadlock if the interrupted sandbox holds one */
+			assert(generic_thread_locks_held == 0);
+			software_interrupt_deferred_sigalrm_clear();
 			scheduler_preempt(user_context);
 		}
 		goto done;
@@ -245,6 +268,9 @@ software_interrupt_initialize(void)
 	sigaddset(&signal_action.sa_mask, SIGALRM);
 	sigaddset(&signal_action.sa_mask, SIGUSR1);
 
+	software_interrupt_deferred_sigalrm_stats = runtime_allocate_per_worker(
+	  sizeof(struct software_interrupt_deferred_sigalrm_stats));
+
 	const int    supported_signals[]   = { SIGALRM, SIGUSR1 };
 	const size_t supported_signals_len = 2;
 
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "listener_thread.h"
+#include "numa_topology.h"
+#include "panic.h"
+#include "runtime.h"
+#include "scheduler.h"
+#include "worker_pool.h"
+
+struct worker_pool worker_pools[WORKER_POOL_MAX];
+uint32_t           worker_pools_count = 0;
+
+/* Per-worker count of requests taken from the queue of a pool on another NUMA node */
+uint64_t *worker_pools_cross_node_steals = NULL;
+
+/* NUMA node of the listener thread, which requests are routed towards when loads are equal */
+static int worker_pools_listener_node = 0;
+
+/**
+ * Adds a pool of the next worker_count workers
+ * @param name
+ * @param worker_count
+ * @param policy scheduling policy of the pool
+ */
+static inline void
+worker_pools_add(const char *name, uint32_t worker_count, enum SCHEDULER policy)
+{
+	if (unlikely(worker_pools_count == WORKER_POOL_MAX))
+		panic("Cannot define more than %d worker pools\n", WORKER_POOL_MAX);
+	if (unlikely(strlen(name) == 0 || strlen(name) >= WORKER_POOL_NAME_MAX_LENGTH))
+		panic("Worker pool names must be between 1 and %d characters\n", WORKER_POOL_NAME_MAX_LENGTH - 1);
+	if (unlikely(worker_pools_find(name) >= 0)) panic("Worker pool %s defined more than once\n", name);
+	if (unlikely(worker_count == 0)) panic("Worker pool %s must have at least one worker\n", name);
+
+	/* FIFO and the minheap-based policies use different local runqueue variants, which are process-wide */
+	if (unlikely((policy == SCHEDULER_FIFO) != (scheduler == SCHEDULER_FIFO)))
+		panic("Worker pool %s cannot use %s with a %s runtime\n", name, scheduler_print(policy),
+		      scheduler_print(scheduler));
+
+	uint32_t first_worker_idx = 0;
+	if (worker_pools_count > 0) {
+		struct worker_pool *previous = &worker_pools[worker_pools_count - 1];
+		first_worker_idx             = previous->first_worker_idx + previous->worker_count;
+	}
+	if (unlikely(first_worker_idx + worker_count > runtime_worker_threads_count))
+		panic("Worker pools require more than the %u available workers\n", runtime_worker_threads_count);
+
+	uint32_t pool_idx        = worker_pools_count++;
+	struct worker_pool *pool = &worker_pools[pool_idx];
+	strncpy(pool->name, name, WORKER_POOL_NAME_MAX_LENGTH);
+	pool->scheduler        = policy;
+	pool->first_worker_idx = first_worker_idx;
+	pool->worker_count     = worker_count;
+	pool->node             = 0;
+	pool->group_idx        = pool_idx;
+	pool->group_count      = 1;
+	atomic_init(&pool->queued_count, 0);
+	atomic_init(&pool->sleeping_count, 0);
+	atomic_init(&pool->early_drop_last_sweep, 0);
+}
+
+/**
+ * Splits each pool whose workers span several NUMA nodes into a group of node-local pools
+ * Assumes workers were placed on cores ordered by node, so the workers of a node are contiguous
+ */
+static inline void
+worker_pools_split_by_node()
+{
+	struct worker_pool configured[WORKER_POOL_MAX];
+	uint32_t           configured_count = worker_pools_count;
+	memcpy(configured, worker_pools, sizeof(struct worker_pool) * configured_count);
+	worker_pools_count = 0;
+
+	for (uint32_t i = 0; i < configured_count; i++) {
+		uint32_t group_idx = worker_pools_count;
+		uint32_t end       = configured[i].first_worker_idx + configured[i].worker_count;
+
+		for (uint32_t worker = configured[i].first_worker_idx; worker < end; worker++) {
+			int node = numa_topology_get_node_of_cpu(runtime_worker_threads_core[worker]);
+
+			/* Extend the current pool while the node is unchanged */
+			if (worker_pools_count > group_idx && worker_pools[worker_pools_count - 1].node == node) {
+				worker_pools[worker_pools_count - 1].worker_count++;
+				continue;
+			}
+
+			if (unlikely(worker_pools_count == WORKER_POOL_MAX))
+				panic("Splitting worker pools by NUMA node requires more than %d pools\n",
+				      WORKER_POOL_MAX);
+
+			struct worker_pool *pool = &worker_pools[worker_pools_count++];
+			*pool                    = configured[i];
+			pool->first_worker_idx   = worker;
+			pool->worker_count       = 1;
+			pool->node               = node;
+			pool->group_idx          = group_idx;
+		}
+
+		for (uint32_t j = group_idx; j < worker_pools_count; j++) {
+			worker_pools[j].group_count = worker_pools_count - group_idx;
+		}
+	}
+
+	worker_pools_listener_node = numa_topology_get_node_of_cpu(listener_thread_core_id);
+}
+
+/**
+ * Partitions the workers into pools
+ * @param specification comma-separated list of name:worker_count[:policy], such as "short:4:EDF,long:3:SRPT". Pools
+ * are assigned consecutive workers in order, and must use all workers. Policy defaults to the runtime policy. If NULL,
+ * a single default pool holds all workers
+ */
+void
+worker_pools_initialize(char *specification)
+{
+	worker_pools_cross_node_steals = runtime_allocate_per_worker(sizeof(uint64_t));
+
+	if (specification == NULL) {
+		worker_pools_add(WORKER_POOL_DEFAULT_NAME, runtime_worker_threads_count, scheduler);
+		if (runtime_numa_enabled) worker_pools_split_by_node();
+		return;
+	}
+
+	char *copy = strdup(specification);
+	if (copy == NULL) panic("Failed to copy worker pool specification\n");
+
+	char *pool_save = NULL;
+	for (char *pool = strtok_r(copy, ",", &pool_save); pool != NULL; pool = strtok_r(NULL, ",", &pool_save)) {
+		char *field_save   = NULL;
+		char *name         = strtok_r(pool, ":", &field_save);
+		char *worker_count = strtok_r(NULL, ":", &field_save);
+		char *policy_raw   = strtok_r(NULL, ":", &field_save);
+		if (name == NULL || worker_count == NULL)
+			panic("Invalid worker pool: %s. Must be name:workers[:policy]\n", pool);
+
+		enum SCHEDULER policy = scheduler;
+		if (policy_raw == NULL) {
+			/* Use the runtime policy */
+		} else if (strcmp(policy_raw, "EDF") == 0) {
+			policy = SCHEDULER_EDF;
+		} else if (strcmp(policy_raw, "FIFO") == 0) {
+			policy = SCHEDULER_FIFO;
+		} else if (strcmp(policy_raw, "LLF") == 0) {
+			policy = SCHEDULER_LLF;
+		} else if (strcmp(policy_raw, "SRPT") == 0) {
+			policy = SCHEDULER_SRPT;
+		} else {
+			panic("Invalid scheduler policy for worker pool %s: %s. Must be {EDF|FIFO|LLF|SRPT}\n", name,
+			      policy_raw);
+		}
+
+		worker_pools_add(name, (uint32_t)atoi(worker_count), policy);
+	}
+	free(copy);
+
+	if (unlikely(worker_pools_count == 0)) panic("SLEDGE_WORKER_POOLS did not define any pools\n");
+
+	struct worker_pool *last = &worker_pools[worker_pools_count - 1];
+	if (unlikely(last->first_worker_idx + last->worker_count != runtime_worker_threads_count))
+		panic("Worker pools must use all %u workers, but only use %u\n", runtime_worker_threads_count,
+		      last->first_worker_idx + last->worker_count);
+
+	if (runtime_numa_enabled) worker_pools_split_by_node();
+}
+
+/**
+ * @param name
+ * @returns the index of the pool with the given name, or -1 if there is no such pool. If the pool was split by NUMA
+ * node, this is the first pool of the group
+ */
+int
+worker_pools_find(const char *name)
+{
+	for (uint32_t i = 0; i < worker_pools_count; i++) {
+		if (strncmp(worker_pools[i].name, name, WORKER_POOL_NAME_MAX_LENGTH) == 0) return (int)i;
+	}
+	return -1;
+}
+
+/**
+ * @param worker_idx
+ * @returns the index of the pool the worker belongs to
+ */
+uint32_t
+worker_pools_get_idx_of_worker(int worker_idx)
+{
+	for (uint32_t i = 0; i < worker_pools_count; i++) {
+		if (worker_idx >= worker_pools[i].first_worker_idx
+		    && worker_idx < worker_pools[i].first_worker_idx + worker_pools[i].worker_count)
+			return i;
+	}
+	panic("Worker %d does not belong to a worker pool\n", worker_idx);
+}
+
+/**
+ * Selects the pool of a group that a new request is added to
+ * This is the pool with the fewest queued requests per worker, preferring the node of the listener on ties
+ * @param pool_idx index of the first pool of a group, as stored by modules
+ * @returns the index of the selected pool
+ */
+uint32_t
+worker_pools_route(uint32_t pool_idx)
+{
+	struct worker_pool *group = &worker_pools[pool_idx];
+	if (group->group_count == 1) return pool_idx;
+
+	uint32_t selected        = pool_idx;
+	uint64_t selected_queued = atomic_load_explicit(&group->queued_count, memory_order_relaxed);
+	for (uint32_t i = pool_idx + 1; i < pool_idx + group->group_count; i++) {
+		uint64_t queued = atomic_load_explicit(&worker_pools[i].queued_count, memory_order_relaxed);
+
+		/* Compare queued / worker_count without division */
+		uint64_t load          = queued * worker_pools[selected].worker_count;
+		uint64_t selected_load = selected_queued * worker_pools[i].worker_count;
+		if (load < selected_load
+		    || (load == selected_load && worker_pools[i].node == worker_pools_listener_node)) {
+			selected        = i;
+			selected_queued = queued;
+		}
+	}
+
+	return selected;
+}
+
+void
+worker_pools_print()
+{
+	for (uint32_t i = 0; i < worker_pools_count; i++) {
+		struct worker_pool *pool = &worker_pools[i];
+		printf("\tWorker Pool %s: %s, workers %u-%u, node %d\n", pool->name, scheduler_print(pool->scheduler),
+		       pool->first_worker_idx, pool->first_worker_idx + pool->worker_count - 1, pool->node);
+	}
+}
+
+void
+worker_pools_cross_node_steals_print()
+{
+	if (!runtime_numa_enabled) return;
+
+	printf("Cross-Node Steals\n");
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		printf("Worker %d: %lu\n", i, worker_pools_cross_node_steals[i]);
+	}
+	fflush(stdout);
+}
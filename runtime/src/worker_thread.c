@@ -5,16 +5,22 @@
 #include <sched.h>
 #include <stdlib.h>
 
+#include "counter_shard.h"
 #include "current_sandbox.h"
 #include "local_completion_queue.h"
+#include "local_rejection_queue.h"
 #include "local_runqueue.h"
 #include "local_runqueue_list.h"
 #include "local_runqueue_minheap.h"
 #include "panic.h"
+#include "perf_counters.h"
 #include "runtime.h"
 #include "scheduler.h"
+#include "software_interrupt.h"
+#include "worker_pool.h"
 #include "worker_thread.h"
 #include "worker_thread_execute_epoll_loop.h"
+#include "worker_thread_idle.h"
 
 /***************************
  * Worker Thread State     *
@@ -28,6 +34,9 @@ __thread int worker_thread_epoll_file_descriptor;
 /* Used to index into global arguments and deadlines arrays */
 __thread int worker_thread_idx;
 
+/* Index of the worker pool this worker belongs to. The listener thread leaves this as 0 */
+__thread uint32_t worker_thread_pool_idx;
+
 /***********************
  * Worker Thread Logic *
  **********************/
@@ -44,7 +53,9 @@ worker_thread_main(void *argument)
 	worker_thread_base_context.variant = ARCH_CONTEXT_VARIANT_RUNNING;
 
 	/* Index was passed via argument */
-	worker_thread_idx = *(int *)argument;
+	worker_thread_idx      = *(int *)argument;
+	worker_thread_pool_idx = worker_pools_get_idx_of_worker(worker_thread_idx);
+	counter_shard_idx      = worker_thread_idx + 1;
 
 	/* Set my priority */
 	// runtime_set_pthread_prio(pthread_self(), 2);
@@ -58,6 +69,8 @@ worker_thread_main(void *argument)
 	/* Initialize epoll */
 	worker_thread_epoll_file_descriptor = epoll_create1(0);
 	if (unlikely(worker_thread_epoll_file_descriptor < 0)) panic_err();
+	worker_thread_idle_eventfd_initialize();
+	perf_counters_initialize_worker();
 
 	/* Unmask signals, unless the runtime has disabled preemption */
 	if (runtime_preemption_enabled) {
@@ -73,12 +86,27 @@ worker_thread_main(void *argument)
 
 		worker_thread_execute_epoll_loop();
 
+		/* This scheduling decision satisfies SIGALRMs deferred by a sandbox that since blocked or exited */
+		software_interrupt_deferred_sigalrm_clear();
+
+		scheduler_sweep_infeasible();
+
 		/* Switch to a sandbox if one is ready to run */
-		next_sandbox = scheduler_get_next();
-		if (next_sandbox != NULL) { scheduler_switch_to(next_sandbox); }
+		next_sandbox = scheduler_get_next(false);
+
+		/* After spinning without work for a while, sleep until a request or I/O arrives */
+		if (next_sandbox == NULL && worker_thread_idle_should_sleep()) next_sandbox = worker_thread_idle_sleep();
+
+		if (next_sandbox != NULL) {
+			worker_thread_idle_reset();
+			scheduler_switch_to(next_sandbox);
+		}
 
 		/* Clear the completion queue */
 		local_completion_queue_free();
+
+		/* Reject the requests the SIGALRM handler could not run */
+		local_rejection_queue_drain();
 	}
 
 	panic("Worker Thread unexpectedly completed run loop.");
@@ -0,0 +1,196 @@
+#include <errno.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "panic.h"
+#include "scheduler.h"
+#include "worker_pool.h"
+#include "worker_thread.h"
+#include "worker_thread_execute_epoll_loop.h"
+#include "worker_thread_idle.h"
+
+struct worker_thread_idle *worker_thread_idle = NULL;
+
+/* Timestamp when the worker ran out of work. 0 while the worker has work */
+__thread uint64_t worker_thread_idle_since = 0;
+
+/**
+ * Allocates the idle state of the workers
+ */
+void
+worker_thread_idle_initialize(void)
+{
+	if (!runtime_worker_idle_sleep_enabled) return;
+
+	worker_thread_idle = runtime_allocate_per_worker(sizeof(struct worker_thread_idle));
+	for (int i = 0; i < runtime_worker_threads_count; i++) { worker_thread_idle[i].eventfd = -1; }
+}
+
+/**
+ * Creates the eventfd of the calling worker and adds it to the worker's epoll instance
+ * The event carries a NULL pointer, which distinguishes it from the events of sandboxes
+ */
+void
+worker_thread_idle_eventfd_initialize(void)
+{
+	if (!runtime_worker_idle_sleep_enabled) return;
+
+	struct worker_thread_idle *self = &worker_thread_idle[worker_thread_idx];
+
+	self->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (unlikely(self->eventfd < 0)) panic_err();
+
+	struct epoll_event event;
+	event.events   = EPOLLIN;
+	event.data.ptr = NULL;
+	if (unlikely(epoll_ctl(worker_thread_epoll_file_descriptor, EPOLL_CTL_ADD, self->eventfd, &event) < 0))
+		panic_err();
+}
+
+/**
+ * Resets the eventfd of the calling worker so that its epoll instance only reports new wakeups
+ */
+void
+worker_thread_idle_eventfd_drain(void)
+{
+	uint64_t value;
+	/* EAGAIN means that the eventfd was already drained */
+	(void)read(worker_thread_idle[worker_thread_idx].eventfd, &value, sizeof(value));
+}
+
+/**
+ * Records the latency between a waker claiming the worker and the worker resuming
+ * @param self
+ */
+static inline void
+worker_thread_idle_record_wakeup(struct worker_thread_idle *self)
+{
+	uint64_t wake_timestamp = atomic_load_explicit(&self->wake_timestamp, memory_order_relaxed);
+	uint64_t latency_us     = (__getcycles() - wake_timestamp) / runtime_processor_speed_MHz;
+	int      bucket         = latency_us == 0 ? 0 : 64 - __builtin_clzll(latency_us);
+	if (bucket >= WORKER_THREAD_IDLE_WAKEUP_BUCKET_COUNT) bucket = WORKER_THREAD_IDLE_WAKEUP_BUCKET_COUNT - 1;
+	self->wakeup_latency[bucket]++;
+}
+
+/**
+ * Puts the calling worker to sleep until a request is added to its pool, one of its blocked sandboxes has I/O ready, or
+ * a signal arrives. Events of blocked sandboxes are processed before returning
+ * @returns a sandbox if a request was found while announcing the sleep, NULL otherwise
+ */
+struct sandbox *
+worker_thread_idle_sleep(void)
+{
+	struct worker_thread_idle *self = &worker_thread_idle[worker_thread_idx];
+	struct worker_pool *       pool = &worker_pools[worker_thread_pool_idx];
+
+	atomic_store(&self->is_sleeping, true);
+	atomic_fetch_add(&pool->sleeping_count, 1);
+
+	/* Pairs with the fence in worker_thread_idle_wake */
+	atomic_thread_fence(memory_order_seq_cst);
+
+	/* Check for a request added before the announcement, which did not see this worker sleeping */
+	struct sandbox *next_sandbox = scheduler_get_next(false);
+	bool            is_woken     = false;
+
+	if (next_sandbox == NULL) {
+		struct epoll_event epoll_events[RUNTIME_MAX_EPOLL_EVENTS];
+		int                descriptor_count = epoll_wait(worker_thread_epoll_file_descriptor, epoll_events,
+                                                  RUNTIME_MAX_EPOLL_EVENTS, -1);
+		/* EINTR means a signal, such as SIGALRM, interrupted the sleep. The caller reruns the scheduler */
+		if (descriptor_count < 0 && errno != EINTR) panic_err();
+
+		for (int i = 0; i < descriptor_count; i++) {
+			if (epoll_events[i].data.ptr == NULL) is_woken = true;
+		}
+		if (descriptor_count > 0) worker_thread_process_epoll_events(epoll_events, descriptor_count);
+	}
+
+	/*
+	 * Withdraw the announcement, unless a waker already claimed this worker. If a waker claimed the worker without it
+	 * having slept, its eventfd write causes a spurious wakeup of the next sleep, which reruns the scheduler
+	 */
+	bool is_sleeping = true;
+	if (atomic_compare_exchange_strong(&self->is_sleeping, &is_sleeping, false)) {
+		atomic_fetch_sub(&pool->sleeping_count, 1);
+	} else if (is_woken) {
+		worker_thread_idle_record_wakeup(self);
+	}
+
+	return next_sandbox;
+}
+
+/**
+ * Wakes a sleeping worker of a pool
+ * @param pool_idx
+ * @returns true if a worker was woken
+ */
+static inline bool
+worker_thread_idle_wake_pool(uint32_t pool_idx)
+{
+	struct worker_pool *pool = &worker_pools[pool_idx];
+	if (atomic_load_explicit(&pool->sleeping_count, memory_order_relaxed) == 0) return false;
+
+	for (uint32_t i = pool->first_worker_idx; i < pool->first_worker_idx + pool->worker_count; i++) {
+		struct worker_thread_idle *worker = &worker_thread_idle[i];
+
+		bool is_sleeping = true;
+		if (!atomic_compare_exchange_strong(&worker->is_sleeping, &is_sleeping, false)) continue;
+
+		atomic_fetch_sub(&pool->sleeping_count, 1);
+		atomic_store_explicit(&worker->wake_timestamp, __getcycles(), memory_order_relaxed);
+
+		uint64_t value = 1;
+		if (unlikely(write(worker->eventfd, &value, sizeof(value)) < 0)) panic_err();
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Wakes a sleeping worker to run a request just added to the queue of a pool. If no worker of the pool sleeps, a worker
+ * of another pool of its NUMA group is woken, as it can steal the request
+ * @param pool_idx
+ */
+void
+worker_thread_idle_wake(uint32_t pool_idx)
+{
+	if (!runtime_worker_idle_sleep_enabled) return;
+
+	/* Pairs with the fence in worker_thread_idle_sleep */
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (worker_thread_idle_wake_pool(pool_idx)) return;
+
+	struct worker_pool *pool = &worker_pools[pool_idx];
+	for (uint32_t i = pool->group_idx; i < pool->group_idx + pool->group_count; i++) {
+		if (i != pool_idx && worker_thread_idle_wake_pool(i)) return;
+	}
+}
+
+void
+worker_thread_idle_wakeup_latency_print(void)
+{
+	if (!runtime_worker_idle_sleep_enabled) return;
+
+	printf("Idle Wakeup Latencies (us)\n");
+	for (int i = 0; i < runtime_worker_threads_count; i++) {
+		printf("Worker %d:", i);
+		for (int j = 0; j < WORKER_THREAD_IDLE_WAKEUP_BUCKET_COUNT; j++) {
+			if (worker_thread_idle[i].wakeup_latency[j] == 0) continue;
+
+			if (j == 0) {
+				printf(" <1: %u", worker_thread_idle[i].wakeup_latency[j]);
+			} else if (j == WORKER_THREAD_IDLE_WAKEUP_BUCKET_COUNT - 1) {
+				printf(" >=%lu: %u", 1UL << (j - 1), worker_thread_idle[i].wakeup_latency[j]);
+			} else {
+				printf(" <%lu: %u", 1UL << j, worker_thread_idle[i].wakeup_latency[j]);
+			}
+		}
+		printf("\n");
+	}
+	fflush(stdout);
+}
@@ -0,0 +1,827 @@
+/*
+ * Open-loop HTTP load generator
+ *
+ * Sends requests at Poisson arrivals or at the offsets of a trace, picking the workload of each request by the weights
+ * of a mix. Arrivals never wait for earlier responses, so a slow server cannot slow down the offered load. Each
+ * request uses its own connection, like hey -disable-keepalive, and all connections are multiplexed over epoll by a
+ * single thread.
+ *
+ * Latency is measured from the time a request was scheduled to be sent rather than from when it was sent. A request
+ * that waited for a free connection or for a late timer is charged for the wait, so the latencies are not hidden by
+ * coordinated omission.
+ *
+ * Usage: loadgen -w <workload>=<port>[:<body>] ... (-r <rate> (-d <seconds> | -n <requests>) | -t <trace>) [options]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "latency_histogram.h"
+
+#define LOADGEN_WORKLOAD_MAX        32
+#define LOADGEN_NAME_MAX            64
+#define LOADGEN_REQUEST_MAX         1024
+#define LOADGEN_RESPONSE_HEADER_MAX 1024
+#define LOADGEN_CONNECTIONS_DEFAULT 1024
+#define LOADGEN_EPOLL_EVENT_COUNT   256
+#define LOADGEN_TIMER_TAG           UINT32_MAX /* epoll data of the arrival timer. Connections use their index */
+#define LOADGEN_FD_RESERVE          16         /* Descriptors kept for stdio, CSVs, epoll, and the timer */
+
+#define NSEC_PER_SEC  1000000000UL
+#define NSEC_PER_USEC 1000UL
+
+/* The columns written by hey -o csv, which the experiment scripts parse. Durations and offsets are in seconds */
+#define LOADGEN_CSV_HEADER \
+	"response-time,DNS+dialup,DNS,Request-write,Response-delay,Response-read,status-code,offset\n"
+
+struct workload {
+	char                     name[LOADGEN_NAME_MAX];
+	struct sockaddr_storage  address;
+	socklen_t                address_length;
+	char                     request[LOADGEN_REQUEST_MAX];
+	size_t                   request_length;
+	uint32_t                 weight;  /* From the mix */
+	FILE                    *csv;     /* NULL unless a results directory is given */
+	struct latency_histogram latency; /* Microseconds from the intended send time to the response, of 200s */
+	uint64_t                 sent;
+	uint64_t                 errors;  /* Failed or timed out requests, and responses other than 200 */
+};
+
+/* A request scheduled to be sent */
+struct arrival {
+	uint64_t intended; /* ns since start */
+	int      workload;
+};
+
+/*
+ * Produces arrivals in order of intended send time, either from a Poisson process over the mix or from a trace. The
+ * next arrival is only consumed once a connection is free to send it, so arrivals held back by the connection limit
+ * keep their intended send time.
+ */
+struct generator {
+	/* Poisson */
+	double         rate;         /* requests per ns */
+	uint64_t       duration;     /* ns. 0 if bounded by count */
+	uint64_t       count;        /* 0 if bounded by duration */
+	uint32_t       weight_total; /* Sum of the weights of the mix */
+	unsigned short random_state[3];
+
+	/* Trace */
+	struct arrival *trace;
+	size_t          trace_length;
+
+	struct arrival next;
+	uint64_t       produced;
+	bool           is_done;
+};
+
+enum connection_state
+{
+	CONNECTION_FREE = 0,
+	CONNECTION_CONNECTING,
+	CONNECTION_WRITING,
+	CONNECTION_READING
+};
+
+struct connection {
+	enum connection_state state;
+	int                   fd;
+	struct arrival        arrival;
+	uint64_t              connect_start; /* ns since start */
+	uint64_t              connect_end;
+	uint64_t              write_end;
+	uint64_t              first_byte;
+	size_t                written;
+	size_t                received;
+	size_t                expected; /* Header and body length from Content-Length. SIZE_MAX until known */
+	char                  header[LOADGEN_RESPONSE_HEADER_MAX];
+	size_t                header_length; /* Bytes of the response kept in header */
+	int                   status;
+	uint32_t              next_free;
+};
+
+static struct workload    workloads[LOADGEN_WORKLOAD_MAX];
+static int                workload_count    = 0;
+static struct connection *connections;
+static uint32_t           connection_count  = LOADGEN_CONNECTIONS_DEFAULT;
+static uint32_t           connection_free   = UINT32_MAX; /* Head of the free list */
+static uint32_t           connection_active = 0;
+static uint64_t           timeout           = 0; /* ns. 0 waits forever */
+static int                epoll_fd;
+static struct timespec    start;
+
+/* Lag from the intended send time to the start of the connect, which shows whether the generator kept up */
+static struct latency_histogram dispatch_lag;
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr,
+	        "Usage: %s -w <workload>=<port>[:<body>] ... (-r <rate> (-d <seconds> | -n <requests>) | -t <trace>)\n"
+	        "\t-H <host>       server to send requests to. Defaults to 127.0.0.1\n"
+	        "\t-w <workload>   name, port, and request body of a workload. Repeat for each workload\n"
+	        "\t-m <mix>        CSV of weight,workload lines picking the workload of each Poisson arrival\n"
+	        "\t-r <rate>       mean Poisson arrivals per second\n"
+	        "\t-d <seconds>    stop sending Poisson arrivals after this long\n"
+	        "\t-n <requests>   stop sending Poisson arrivals after this many\n"
+	        "\t-t <trace>      CSV of offset,workload lines, with offsets in seconds, replacing Poisson arrivals\n"
+	        "\t-c <count>      maximum concurrent connections. Defaults to %d\n"
+	        "\t-T <seconds>    fail requests without a response after this long. Defaults to waiting forever\n"
+	        "\t-o <directory>  write a <workload>.csv of every request in the format of hey -o csv\n"
+	        "\t-s <seed>       seed of the arrival times and the mix. Defaults to the time\n",
+	        name, LOADGEN_CONNECTIONS_DEFAULT);
+}
+
+static inline uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start.tv_sec) * NSEC_PER_SEC + now.tv_nsec - start.tv_nsec;
+}
+
+static inline double
+ns_to_s(uint64_t ns)
+{
+	return (double)ns / NSEC_PER_SEC;
+}
+
+/**
+ * @param name
+ * @returns the index of the workload, or -1 if it was not given with -w
+ */
+static int
+workload_find(const char *name)
+{
+	for (int i = 0; i < workload_count; i++) {
+		if (strcmp(workloads[i].name, name) == 0) return i;
+	}
+	return -1;
+}
+
+/**
+ * Adds a workload from a -w argument, resolving its address and formatting its request
+ * @param host
+ * @param argument <workload>=<port>[:<body>]
+ * @returns 0 on success, -1 on error
+ */
+static int
+workload_add(const char *host, char *argument)
+{
+	char *port = strchr(argument, '=');
+	if (port == NULL || port == argument || port - argument >= LOADGEN_NAME_MAX) {
+		fprintf(stderr, "Invalid workload %s, expected <workload>=<port>[:<body>]\n", argument);
+		return -1;
+	}
+	*port++ = '\0';
+
+	const char *body  = "";
+	char       *colon = strchr(port, ':');
+	if (colon != NULL) {
+		*colon = '\0';
+		body   = colon + 1;
+	}
+
+	if (workload_find(argument) >= 0) {
+		fprintf(stderr, "Workload %s is given twice\n", argument);
+		return -1;
+	}
+
+	struct workload *self = &workloads[workload_count];
+	strcpy(self->name, argument);
+
+	struct addrinfo  hints  = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *result = NULL;
+	int              rc     = getaddrinfo(host, port, &hints, &result);
+	if (rc != 0) {
+		fprintf(stderr, "Failed to resolve %s:%s: %s\n", host, port, gai_strerror(rc));
+		return -1;
+	}
+	memcpy(&self->address, result->ai_addr, result->ai_addrlen);
+	self->address_length = result->ai_addrlen;
+	freeaddrinfo(result);
+
+	rc = snprintf(self->request, LOADGEN_REQUEST_MAX,
+	              "GET / HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n"
+	              "Connection: close\r\n\r\n%s",
+	              host, port, strlen(body), body);
+	if (rc < 0 || rc >= LOADGEN_REQUEST_MAX) {
+		fprintf(stderr, "The request of workload %s is longer than %d bytes\n", self->name,
+		        LOADGEN_REQUEST_MAX);
+		return -1;
+	}
+	self->request_length = rc;
+	self->weight         = 1;
+
+	workload_count++;
+	return 0;
+}
+
+/**
+ * Sets the weights of the workloads from a mix file of weight,workload lines, like experiments/workload_mix/mix.csv.
+ * Workloads missing from the mix are never picked
+ * @param path
+ * @param generator
+ * @returns 0 on success, -1 on error
+ */
+static int
+mix_read(const char *path, struct generator *generator)
+{
+	FILE *mix = fopen(path, "r");
+	if (mix == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	for (int i = 0; i < workload_count; i++) workloads[i].weight = 0;
+
+	char     line[256];
+	char     name[LOADGEN_NAME_MAX];
+	uint32_t weight;
+	int      line_number = 0;
+	while (fgets(line, sizeof(line), mix) != NULL) {
+		line_number++;
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+
+		if (sscanf(line, "%u,%63[^,\r\n]", &weight, name) != 2) {
+			fprintf(stderr, "%s:%d: expected weight,workload\n", path, line_number);
+			fclose(mix);
+			return -1;
+		}
+
+		int workload = workload_find(name);
+		if (workload < 0) {
+			fprintf(stderr, "%s:%d: workload %s was not given with -w\n", path, line_number, name);
+			fclose(mix);
+			return -1;
+		}
+		workloads[workload].weight += weight;
+	}
+	fclose(mix);
+
+	generator->weight_total = 0;
+	for (int i = 0; i < workload_count; i++) generator->weight_total += workloads[i].weight;
+	if (generator->weight_total == 0) {
+		fprintf(stderr, "%s has no weights\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Reads a trace of offset,workload lines, with offsets in seconds from the start in non-decreasing order. This is the
+ * offset column written by hey and by loadgen -o, so the arrivals of a run can be replayed
+ * @param path
+ * @param generator
+ * @returns 0 on success, -1 on error
+ */
+static int
+trace_read(const char *path, struct generator *generator)
+{
+	FILE *trace = fopen(path, "r");
+	if (trace == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	size_t capacity         = 1024;
+	generator->trace        = malloc(capacity * sizeof(struct arrival));
+	generator->trace_length = 0;
+	if (generator->trace == NULL) {
+		perror("malloc");
+		fclose(trace);
+		return -1;
+	}
+
+	char   line[256];
+	char   name[LOADGEN_NAME_MAX];
+	double offset;
+	int    line_number = 0;
+	while (fgets(line, sizeof(line), trace) != NULL) {
+		line_number++;
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+
+		if (sscanf(line, "%lf,%63[^,\r\n]", &offset, name) != 2 || offset < 0) {
+			fprintf(stderr, "%s:%d: expected offset,workload\n", path, line_number);
+			goto err;
+		}
+
+		int workload = workload_find(name);
+		if (workload < 0) {
+			fprintf(stderr, "%s:%d: workload %s was not given with -w\n", path, line_number, name);
+			goto err;
+		}
+
+		uint64_t intended = (uint64_t)(offset * NSEC_PER_SEC);
+		if (generator->trace_length > 0 && intended < generator->trace[generator->trace_length - 1].intended) {
+			fprintf(stderr, "%s:%d: offsets must not decrease\n", path, line_number);
+			goto err;
+		}
+
+		if (generator->trace_length == capacity) {
+			capacity *= 2;
+			struct arrival *grown = realloc(generator->trace, capacity * sizeof(struct arrival));
+			if (grown == NULL) {
+				perror("realloc");
+				goto err;
+			}
+			generator->trace = grown;
+		}
+		generator->trace[generator->trace_length++] = (struct arrival){ .intended = intended,
+			                                                         .workload = workload };
+	}
+	fclose(trace);
+
+	if (generator->trace_length == 0) {
+		fprintf(stderr, "%s has no arrivals\n", path);
+		return -1;
+	}
+	return 0;
+
+err:
+	fclose(trace);
+	return -1;
+}
+
+/**
+ * Advances the generator to its next arrival, setting is_done once there are none left
+ * @param self
+ */
+static void
+generator_advance(struct generator *self)
+{
+	if (self->trace != NULL) {
+		if (self->produced == self->trace_length) {
+			self->is_done = true;
+			return;
+		}
+		self->next = self->trace[self->produced++];
+		return;
+	}
+
+	if (self->count > 0 && self->produced == self->count) {
+		self->is_done = true;
+		return;
+	}
+
+	/* Exponential inter-arrival times. erand48 returns [0, 1), so the logarithm is finite */
+	double   interval = -log(1.0 - erand48(self->random_state)) / self->rate;
+	uint64_t intended = self->next.intended + (uint64_t)interval;
+	if (self->duration > 0 && intended >= self->duration) {
+		self->is_done = true;
+		return;
+	}
+
+	uint32_t roll     = (uint32_t)(erand48(self->random_state) * self->weight_total);
+	int      workload = 0;
+	while (roll >= workloads[workload].weight) roll -= workloads[workload++].weight;
+
+	self->next = (struct arrival){ .intended = intended, .workload = workload };
+	self->produced++;
+}
+
+/**
+ * Writes the CSV row of a finished request and records its latency
+ * @param self
+ * @param status HTTP status, or 0 if the request failed before a response
+ */
+static void
+connection_finish(struct connection *self, int status)
+{
+	uint64_t         now      = now_ns();
+	struct workload *workload = &workloads[self->arrival.workload];
+
+	/* A response that arrives after the timeout, before the sweep noticed, has still timed out */
+	if (timeout > 0 && now - self->arrival.intended > timeout) status = 0;
+
+	if (status == 200) {
+		latency_histogram_record(&workload->latency, (now - self->arrival.intended) / NSEC_PER_USEC);
+	} else {
+		workload->errors++;
+	}
+
+	/* Phases the request did not reach are 0. The response time includes the wait for a connection */
+	uint64_t connect_end = self->connect_end > 0 ? self->connect_end : now;
+	uint64_t write_end   = self->write_end > 0 ? self->write_end : connect_end;
+	uint64_t first_byte  = self->first_byte > 0 ? self->first_byte : write_end;
+	if (workload->csv != NULL) {
+		fprintf(workload->csv, "%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%.4f\n", ns_to_s(now - self->arrival.intended),
+		        ns_to_s(connect_end - self->connect_start), 0.0, ns_to_s(write_end - connect_end),
+		        ns_to_s(first_byte - write_end), ns_to_s(now - first_byte), status,
+		        ns_to_s(self->arrival.intended));
+	}
+
+	/* Closing the descriptor removes it from the epoll set */
+	close(self->fd);
+	self->state     = CONNECTION_FREE;
+	self->next_free = connection_free;
+	connection_free = self - connections;
+	connection_active--;
+}
+
+/**
+ * Opens a connection for an arrival
+ * @param arrival
+ */
+static void
+connection_open(struct arrival *arrival)
+{
+	uint32_t           idx      = connection_free;
+	struct connection *self     = &connections[idx];
+	struct workload   *workload = &workloads[arrival->workload];
+	connection_free             = self->next_free;
+	connection_active++;
+
+	*self = (struct connection){ .state         = CONNECTION_CONNECTING,
+		                     .arrival       = *arrival,
+		                     .connect_start = now_ns(),
+		                     .expected      = SIZE_MAX };
+	latency_histogram_record(&dispatch_lag, (self->connect_start - arrival->intended) / NSEC_PER_USEC);
+	workload->sent++;
+
+	self->fd = socket(workload->address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (self->fd < 0) {
+		fprintf(stderr, "Failed to open socket: %s\n", strerror(errno));
+		goto err;
+	}
+
+	if (connect(self->fd, (struct sockaddr *)&workload->address, workload->address_length) < 0
+	    && errno != EINPROGRESS) {
+		goto err;
+	}
+
+	struct epoll_event event = { .events = EPOLLOUT, .data.u32 = idx };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, self->fd, &event) < 0) {
+		fprintf(stderr, "Failed to add socket to epoll: %s\n", strerror(errno));
+		goto err;
+	}
+	return;
+
+err:
+	connection_finish(self, 0);
+}
+
+/**
+ * Parses the status and Content-Length of a response once its header is complete
+ * @param self
+ */
+static void
+connection_parse_header(struct connection *self)
+{
+	char *end = memmem(self->header, self->header_length, "\r\n\r\n", 4);
+	if (end == NULL) return;
+	*end = '\0';
+
+	int minor;
+	if (sscanf(self->header, "HTTP/1.%d %d", &minor, &self->status) != 2) self->status = 0;
+
+	char *content_length = strcasestr(self->header, "\r\nContent-Length:");
+	if (content_length != NULL) {
+		self->expected = (end + 4 - self->header) + strtoul(content_length + 17, NULL, 10);
+	}
+}
+
+/**
+ * Advances a connection on an epoll event
+ * @param self
+ */
+static void
+connection_handle(struct connection *self)
+{
+	switch (self->state) {
+	case CONNECTION_CONNECTING: {
+		int       error  = 0;
+		socklen_t length = sizeof(error);
+		if (getsockopt(self->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+			connection_finish(self, 0);
+			return;
+		}
+		self->connect_end = now_ns();
+		self->state       = CONNECTION_WRITING;
+	}
+		/* fallthrough */
+	case CONNECTION_WRITING: {
+		struct workload *workload = &workloads[self->arrival.workload];
+		while (self->written < workload->request_length) {
+			ssize_t rc = send(self->fd, workload->request + self->written,
+			                  workload->request_length - self->written, MSG_NOSIGNAL);
+			if (rc < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+				connection_finish(self, 0);
+				return;
+			}
+			self->written += rc;
+		}
+		self->write_end = now_ns();
+		self->state     = CONNECTION_READING;
+
+		struct epoll_event event = { .events = EPOLLIN, .data.u32 = self - connections };
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, self->fd, &event) < 0) connection_finish(self, 0);
+		return;
+	}
+	case CONNECTION_READING: {
+		char buffer[4096];
+		while (true) {
+			ssize_t rc = read(self->fd, buffer, sizeof(buffer));
+			if (rc < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+				connection_finish(self, 0);
+				return;
+			}
+			if (rc == 0) {
+				/* Without a Content-Length, the server closing the connection ends the response */
+				connection_finish(self, self->status);
+				return;
+			}
+
+			if (self->first_byte == 0) self->first_byte = now_ns();
+			if (self->status == 0 && self->header_length < LOADGEN_RESPONSE_HEADER_MAX - 1) {
+				size_t kept = LOADGEN_RESPONSE_HEADER_MAX - 1 - self->header_length;
+				if (kept > (size_t)rc) kept = rc;
+				memcpy(self->header + self->header_length, buffer, kept);
+				self->header_length += kept;
+				self->header[self->header_length] = '\0';
+				connection_parse_header(self);
+			}
+			self->received += rc;
+
+			if (self->received >= self->expected) {
+				connection_finish(self, self->status);
+				return;
+			}
+		}
+	}
+	case CONNECTION_FREE:
+		return;
+	}
+}
+
+/**
+ * Fails requests that have waited longer than the timeout since their intended send time
+ */
+static void
+connections_expire(void)
+{
+	uint64_t now = now_ns();
+	for (uint32_t i = 0; i < connection_count; i++) {
+		struct connection *self = &connections[i];
+		if (self->state == CONNECTION_FREE) continue;
+		if (now - self->arrival.intended > timeout) connection_finish(self, 0);
+	}
+}
+
+/**
+ * Arms the arrival timer for an intended send time, or disarms it
+ * @param timer_fd
+ * @param intended ns since start, or 0 to disarm
+ */
+static void
+timer_arm(int timer_fd, uint64_t intended)
+{
+	struct itimerspec timer = { 0 };
+	if (intended > 0) {
+		uint64_t nsec          = start.tv_nsec + intended;
+		timer.it_value.tv_sec  = start.tv_sec + nsec / NSEC_PER_SEC;
+		timer.it_value.tv_nsec = nsec % NSEC_PER_SEC;
+	}
+	if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) < 0) {
+		perror("timerfd_settime");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * Raises the descriptor limit to fit the connections, or lowers the connection count to fit the limit
+ */
+static void
+connections_fit_descriptor_limit(void)
+{
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) < 0) return;
+
+	rlim_t needed = connection_count + workload_count + LOADGEN_FD_RESERVE;
+	if (limit.rlim_cur >= needed) return;
+
+	limit.rlim_cur = limit.rlim_max < needed ? limit.rlim_max : needed;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	if (limit.rlim_cur < needed) {
+		connection_count = limit.rlim_cur - workload_count - LOADGEN_FD_RESERVE;
+		fprintf(stderr, "Descriptor limit of %lu allows %u connections\n", (unsigned long)limit.rlim_cur,
+		        connection_count);
+	}
+}
+
+/**
+ * Prints a summary of each workload to stdout, with latencies in ms from the histograms
+ * @param elapsed ns
+ */
+static void
+summary_print(uint64_t elapsed)
+{
+	printf("Payload,Sent,Errors,Throughput,p50,p90,p99,p100\n");
+	for (int i = 0; i < workload_count; i++) {
+		struct workload *workload = &workloads[i];
+		uint64_t         oks      = latency_histogram_get_count(&workload->latency);
+		printf("%s,%lu,%lu,%.2f,%.4f,%.4f,%.4f,%.4f\n", workload->name, workload->sent, workload->errors,
+		       oks / ns_to_s(elapsed), latency_histogram_get_quantile(&workload->latency, oks, 0.5) / 1000.0,
+		       latency_histogram_get_quantile(&workload->latency, oks, 0.9) / 1000.0,
+		       latency_histogram_get_quantile(&workload->latency, oks, 0.99) / 1000.0,
+		       latency_histogram_get_quantile(&workload->latency, oks, 1) / 1000.0);
+	}
+
+	uint64_t dispatched = latency_histogram_get_count(&dispatch_lag);
+	fprintf(stderr, "Dispatch lag (us): p50 %u, p99 %u, max %u\n",
+	        latency_histogram_get_quantile(&dispatch_lag, dispatched, 0.5),
+	        latency_histogram_get_quantile(&dispatch_lag, dispatched, 0.99),
+	        latency_histogram_get_quantile(&dispatch_lag, dispatched, 1));
+}
+
+int
+main(int argc, char **argv)
+{
+	const char      *host       = "127.0.0.1";
+	const char      *mix_path   = NULL;
+	const char      *trace_path = NULL;
+	const char      *results    = NULL;
+	double           rate       = 0;
+	double           duration   = 0;
+	long             seed       = time(NULL);
+	struct generator generator  = { 0 };
+	char            *workload_arguments[LOADGEN_WORKLOAD_MAX];
+	int              workload_argument_count = 0;
+
+	int option;
+	while ((option = getopt(argc, argv, "H:w:m:r:d:n:t:c:T:o:s:")) != -1) {
+		switch (option) {
+		case 'H':
+			host = optarg;
+			break;
+		case 'w':
+			if (workload_argument_count == LOADGEN_WORKLOAD_MAX) {
+				fprintf(stderr, "At most %d workloads are supported\n", LOADGEN_WORKLOAD_MAX);
+				return EXIT_FAILURE;
+			}
+			workload_arguments[workload_argument_count++] = optarg;
+			break;
+		case 'm':
+			mix_path = optarg;
+			break;
+		case 'r':
+			rate = atof(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'n':
+			generator.count = strtoull(optarg, NULL, 10);
+			break;
+		case 't':
+			trace_path = optarg;
+			break;
+		case 'c':
+			connection_count = strtoul(optarg, NULL, 10);
+			break;
+		case 'T':
+			timeout = (uint64_t)(atof(optarg) * NSEC_PER_SEC);
+			break;
+		case 'o':
+			results = optarg;
+			break;
+		case 's':
+			seed = strtol(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Resolved once all options are parsed, as -H may follow -w */
+	for (int i = 0; i < workload_argument_count; i++) {
+		if (workload_add(host, workload_arguments[i]) < 0) return EXIT_FAILURE;
+	}
+
+	if (workload_count == 0 || connection_count == 0 || (trace_path == NULL && rate <= 0)
+	    || (trace_path == NULL && duration <= 0 && generator.count == 0)) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (trace_path != NULL) {
+		if (trace_read(trace_path, &generator) < 0) return EXIT_FAILURE;
+	} else {
+		generator.rate            = rate / NSEC_PER_SEC;
+		generator.duration        = (uint64_t)(duration * NSEC_PER_SEC);
+		generator.random_state[0] = (unsigned short)seed;
+		generator.random_state[1] = (unsigned short)(seed >> 16);
+		generator.random_state[2] = (unsigned short)(seed >> 32);
+		generator.weight_total    = workload_count;
+		if (mix_path != NULL && mix_read(mix_path, &generator) < 0) return EXIT_FAILURE;
+	}
+
+	if (results != NULL) {
+		for (int i = 0; i < workload_count; i++) {
+			char path[PATH_MAX];
+			int  rc = snprintf(path, sizeof(path), "%s/%s.csv", results, workloads[i].name);
+			if (rc < 0 || rc >= PATH_MAX) {
+				fprintf(stderr, "Results directory %s is too long\n", results);
+				return EXIT_FAILURE;
+			}
+			workloads[i].csv = fopen(path, "w");
+			if (workloads[i].csv == NULL) {
+				perror(path);
+				return EXIT_FAILURE;
+			}
+			fputs(LOADGEN_CSV_HEADER, workloads[i].csv);
+		}
+	}
+
+	connections_fit_descriptor_limit();
+	connections = calloc(connection_count, sizeof(struct connection));
+	if (connections == NULL) {
+		perror("calloc");
+		return EXIT_FAILURE;
+	}
+	for (uint32_t i = 0; i < connection_count; i++) connections[i].next_free = i + 1;
+	connections[connection_count - 1].next_free = UINT32_MAX;
+	connection_free                             = 0;
+
+	epoll_fd     = epoll_create1(EPOLL_CLOEXEC);
+	int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (epoll_fd < 0 || timer_fd < 0) {
+		perror("epoll_create1 or timerfd_create");
+		return EXIT_FAILURE;
+	}
+	struct epoll_event timer_event = { .events = EPOLLIN, .data.u32 = LOADGEN_TIMER_TAG };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event) < 0) {
+		perror("epoll_ctl");
+		return EXIT_FAILURE;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	generator_advance(&generator);
+
+	struct epoll_event events[LOADGEN_EPOLL_EVENT_COUNT];
+	while (!generator.is_done || connection_active > 0) {
+		/* Send the arrivals that are due. Those over the connection limit wait, keeping their intended time */
+		uint64_t now = now_ns();
+		while (!generator.is_done && generator.next.intended <= now && connection_free != UINT32_MAX) {
+			connection_open(&generator.next);
+			generator_advance(&generator);
+		}
+
+		/* A completion frees a connection for a held back arrival, so only wait on the timer if one is free */
+		bool is_waiting = !generator.is_done && connection_free != UINT32_MAX;
+		timer_arm(timer_fd, is_waiting ? generator.next.intended : 0);
+
+		/* Wake up to sweep for timeouts at least once per timeout, and at most once per ms */
+		int wait_ms = -1;
+		if (timeout > 0) wait_ms = timeout < NSEC_PER_SEC ? timeout / 1000000 + 1 : 1000;
+		int count   = epoll_wait(epoll_fd, events, LOADGEN_EPOLL_EVENT_COUNT, wait_ms);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			perror("epoll_wait");
+			return EXIT_FAILURE;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.u32 == LOADGEN_TIMER_TAG) {
+				uint64_t expirations;
+				if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+					perror("read timerfd");
+				}
+				continue;
+			}
+			connection_handle(&connections[events[i].data.u32]);
+		}
+
+		if (timeout > 0) connections_expire();
+	}
+
+	summary_print(now_ns());
+
+	for (int i = 0; i < workload_count; i++) {
+		if (workloads[i].csv != NULL) fclose(workloads[i].csv);
+	}
+	free(connections);
+	free(generator.trace);
+	close(timer_fd);
+	close(epoll_fd);
+	return EXIT_SUCCESS;
+}
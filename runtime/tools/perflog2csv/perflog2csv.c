@@ -0,0 +1,98 @@
+/*
+ * Converts a binary sandbox perf log, written by sledgert when SLEDGE_SANDBOX_PERF_LOG is set, to CSV
+ *
+ * Usage: perflog2csv <log> [csv]
+ * Writes to stdout if no CSV path is given
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sandbox_perf_log_format.h"
+
+/**
+ * Writes a hardware counter column, left empty if the worker could not count the event
+ * @param csv
+ * @param count
+ */
+static void
+perflog2csv_write_counter(FILE *csv, uint64_t count)
+{
+	if (count == SANDBOX_PERF_LOG_COUNTER_UNAVAILABLE) {
+		fprintf(csv, ",");
+	} else {
+		fprintf(csv, ",%lu", count);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "%s <log> [csv]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *log = fopen(argv[1], "rb");
+	if (log == NULL) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *csv = stdout;
+	if (argc == 3) {
+		csv = fopen(argv[2], "w");
+		if (csv == NULL) {
+			perror(argv[2]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	struct sandbox_perf_log_header header;
+	if (fread(&header, sizeof(header), 1, log) != 1
+	    || memcmp(header.magic, SANDBOX_PERF_LOG_MAGIC, sizeof(header.magic)) != 0) {
+		fprintf(stderr, "%s is not a sandbox perf log\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if (header.version != SANDBOX_PERF_LOG_VERSION || header.record_size != sizeof(struct sandbox_perf_log_record)
+	    || header.label_length != SANDBOX_PERF_LOG_LABEL_LENGTH) {
+		fprintf(stderr, "%s has version %u with %u byte records, expected version %u with %zu byte records\n",
+		        argv[1], header.version, header.record_size, SANDBOX_PERF_LOG_VERSION,
+		        sizeof(struct sandbox_perf_log_record));
+		return EXIT_FAILURE;
+	}
+
+	char(*labels)[SANDBOX_PERF_LOG_LABEL_LENGTH] = calloc(header.state_count, SANDBOX_PERF_LOG_LABEL_LENGTH);
+	if (labels == NULL || fread(labels, SANDBOX_PERF_LOG_LABEL_LENGTH, header.state_count, log) != header.state_count) {
+		fprintf(stderr, "%s has a truncated header\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	for (uint32_t i = 0; i < header.state_count; i++) labels[i][SANDBOX_PERF_LOG_LABEL_LENGTH - 1] = '\0';
+
+	/* The columns of the CSV log written by the runtime before the binary log, followed by the hardware counters */
+	fprintf(csv, "id,function,state,deadline,actual,queued,initializing,runnable,running,blocked,returned,memory,"
+	             "cycles,instructions,llc_misses,dtlb_misses\n");
+
+	struct sandbox_perf_log_record record;
+	uint64_t                       count = 0;
+	while (fread(&record, sizeof(record), 1, log) == 1) {
+		const char *state = record.state < header.state_count ? labels[record.state] : "Unknown";
+		fprintf(csv, "%lu,%.*s():%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u", record.id, SANDBOX_PERF_LOG_NAME_LENGTH,
+		        record.module_name, record.module_port, state, record.relative_deadline_us, record.total_time_us,
+		        record.queued_us, record.initializing_us, record.runnable_us, record.running_us,
+		        record.blocked_us, record.returned_us, record.linear_memory_size);
+		perflog2csv_write_counter(csv, record.cycles);
+		perflog2csv_write_counter(csv, record.instructions);
+		perflog2csv_write_counter(csv, record.llc_misses);
+		perflog2csv_write_counter(csv, record.dtlb_misses);
+		fprintf(csv, "\n");
+		count++;
+	}
+
+	fprintf(stderr, "Converted %lu records\n", count);
+
+	free(labels);
+	fclose(log);
+	if (csv != stdout) fclose(csv);
+	return EXIT_SUCCESS;
+}